@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <sstream>
+
+#include "batch.h"
+
+// one run through the interpreter, for machines without vector support and for comparison
+static void runSerial(const VMImage& image, const std::vector<int32_t>& record, BatchResult& result) {
+    std::ostringstream input;
+    for (int32_t value : record) input << value << '\n';
+    std::istringstream in(input.str());
+    std::ostringstream out;
+    VMResult run = runProgram(image, in, out);
+    result.ok = run.ok;
+    result.error = run.error;
+    std::istringstream written(out.str());
+    long long value = 0;
+    while (written >> value) result.output.push_back(static_cast<int32_t>(value));
+}
+
+#if defined(__GNUC__)
+
+// BATCH_LANES 32-bit lanes; arithmetic is unsigned so it wraps like the target
+typedef uint32_t LaneVec __attribute__((vector_size(BATCH_LANES * sizeof(uint32_t))));
+typedef int32_t LaneInt __attribute__((vector_size(BATCH_LANES * sizeof(int32_t))));
+typedef double LaneDouble __attribute__((vector_size(BATCH_LANES * sizeof(double))));
+static_assert(BATCH_LANES <= 32, "lane masks are 32-bit");
+
+// an AVX2 and a baseline (SSE2 on x86-64) copy of the executor, picked at load time
+#if defined(__x86_64__) && !defined(__clang__)
+#define BATCH_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define BATCH_TARGETS
+#endif
+
+// run every record. each lane holds one record at a time and takes the next one as soon as
+// its record stops or fails, so lanes never idle while records remain. mem holds one
+// LaneVec per cell. lanes not in active are parked at pc[lane]; waitPc is the lowest of
+// those ahead of ip, where the running lanes pick up the parked ones. whenever lanes go
+// separate ways the ones at the lowest pc run first, so lanes split by a cond meet again
+// after it; a loop jumping back yields to lanes parked past its end, so a few
+// long-running records do not hold up the rest
+BATCH_TARGETS
+static void runLanes(const VMImage& image, LaneVec* mem, const std::vector<std::vector<int32_t>>& records,
+                     std::vector<BatchResult>& results) {
+    const VMInstr* const code = image.code.data();
+    const VMInstr* ip = code;
+    LaneVec acc = {};
+    LaneVec activeVec = {};
+    LaneVec operand = {};
+    LaneVec parkedVec = {};             // lanes of a simple split, see VM_BRANCH
+    LaneVec laneBit;
+    for (unsigned l = 0; l < BATCH_LANES; ++l) laneBit[l] = 1u << l;
+    size_t record[BATCH_LANES] = {}, consumed[BATCH_LANES] = {};
+    int32_t pc[BATCH_LANES] = {};
+    size_t next = 0;                    // first record not yet given to a lane
+    uint32_t active = 0, parked = 0, candidates = 0, taken = 0, beyond = 0;
+    uint32_t freed = BATCH_LANES == 32 ? ~0u : (1u << BATCH_LANES) - 1;
+    int32_t waitPc = INT_MAX, from = 0;
+    bool split = false;                 // parked lanes are exactly parkedVec, all at waitPc
+    const char* error = nullptr;
+
+#define LANES(mask, l) for (unsigned l = 0; l < BATCH_LANES; ++l) if ((mask) >> l & 1)
+#define BLEND(mask, a, b) (((a) & (mask)) | ((b) & ~(mask)))
+    // must list the handlers in VMOp order; not static, so the function can be cloned per target
+    const void* const handlers[] = {
+        &&op_READ, &&op_WRITE_M, &&op_WRITE_I, &&op_LOAD_M, &&op_LOAD_I, &&op_STORE,
+        &&op_ADD_M, &&op_ADD_I, &&op_SUB_M, &&op_SUB_I, &&op_MULT_M, &&op_MULT_I, &&op_DIV_M, &&op_DIV_I,
+        &&op_BR, &&op_BRNEG, &&op_BRZNEG, &&op_BRPOS, &&op_BRZPOS, &&op_BRZERO, &&op_NOOP, &&op_STOP,
+    };
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH() goto *handlers[static_cast<int>(ip->op)]
+#define VM_NEXT() do { if (++ip - code == waitPc) goto absorb; VM_DISPATCH(); } while (0)
+    // a forward jump past parked lanes lets them run first; a backward one may yield
+#define VM_GOTO(target) do {                                                            \
+        from = ip - code;                                                               \
+        ip = code + (target);                                                           \
+        if (ip - code < from) {                                                         \
+            if (!parked) VM_DISPATCH();                                                 \
+            goto backedge;                                                              \
+        }                                                                               \
+        if (ip - code < waitPc) VM_DISPATCH();                                          \
+        if (ip - code == waitPc) goto absorb;                                           \
+        goto park;                                                                      \
+    } while (0)
+#define VM_ARITH(op, value) do { operand = (value); acc = BLEND(activeVec, acc op operand, acc); VM_NEXT(); } while (0)
+    // active lanes where cond holds take the branch, the others fall through
+#define VM_BRANCH(cond) do {                                                            \
+        operand = (LaneVec)(cond) & activeVec & laneBit;                              \
+        taken = 0;                                                                      \
+        for (unsigned l = 0; l < BATCH_LANES; ++l) taken |= operand[l];                 \
+        if (taken == active) VM_GOTO(ip->operand);                                      \
+        if (taken == 0) VM_NEXT();                                                      \
+        if (!parked && ip->operand > ip - code + 1) {                                   \
+            /* the usual cond: park the lanes that skip it, run the rest up to them */  \
+            LANES(taken, l) pc[l] = ip->operand;                                        \
+            parked = taken;                                                             \
+            active &= ~taken;                                                           \
+            waitPc = ip->operand;                                                       \
+            parkedVec = activeVec & (LaneVec)(cond);                                    \
+            activeVec &= ~parkedVec;                                                    \
+            split = true;                                                               \
+            ++ip;                                                                       \
+            VM_DISPATCH();                                                              \
+        }                                                                               \
+        LANES(active, l) pc[l] = (taken >> l & 1) ? ip->operand : ip - code + 1;        \
+        parked |= active;                                                               \
+        active = 0;                                                                     \
+        candidates = parked;                                                            \
+        goto select;                                                                    \
+    } while (0)
+#define VM_FAIL(l, message) do {                                                        \
+        error = message;                                                                \
+        active &= ~(1u << l);                                                           \
+        freed |= 1u << l;                                                               \
+        results[record[l]].ok = false;                                                  \
+        results[record[l]].error = "instruction " + std::to_string(ip - code + 1) + ": " + error; \
+    } while (0)
+
+    goto refill;
+
+    VM_CASE(READ) {
+        LANES(active, l) {
+            if (consumed[l] >= records[record[l]].size()) {
+                VM_FAIL(l, "READ: expected an integer on input");
+                continue;
+            }
+            mem[ip->operand][l] = static_cast<uint32_t>(records[record[l]][consumed[l]++]);
+        }
+        if (error) goto failed;
+        VM_NEXT();
+    }
+    VM_CASE(WRITE_M) {
+        LANES(active, l) results[record[l]].output.push_back(static_cast<int32_t>(mem[ip->operand][l]));
+        VM_NEXT();
+    }
+    VM_CASE(WRITE_I) {
+        LANES(active, l) results[record[l]].output.push_back(ip->operand);
+        VM_NEXT();
+    }
+    VM_CASE(LOAD_M) { acc = BLEND(activeVec, mem[ip->operand], acc); VM_NEXT(); }
+    VM_CASE(LOAD_I) { operand = LaneVec{} + static_cast<uint32_t>(ip->operand); acc = BLEND(activeVec, operand, acc); VM_NEXT(); }
+    VM_CASE(STORE) { mem[ip->operand] = BLEND(activeVec, acc, mem[ip->operand]); VM_NEXT(); }
+    VM_CASE(ADD_M) { VM_ARITH(+, mem[ip->operand]); }
+    VM_CASE(ADD_I) { VM_ARITH(+, LaneVec{} + static_cast<uint32_t>(ip->operand)); }
+    VM_CASE(SUB_M) { VM_ARITH(-, mem[ip->operand]); }
+    VM_CASE(SUB_I) { VM_ARITH(-, LaneVec{} + static_cast<uint32_t>(ip->operand)); }
+    VM_CASE(MULT_M) { VM_ARITH(*, mem[ip->operand]); }
+    VM_CASE(MULT_I) { VM_ARITH(*, LaneVec{} + static_cast<uint32_t>(ip->operand)); }
+    VM_CASE(DIV_M) { operand = mem[ip->operand]; goto divide; }
+    VM_CASE(DIV_I) { operand = LaneVec{} + static_cast<uint32_t>(ip->operand); goto divide; }
+    VM_CASE(BR) { VM_GOTO(ip->operand); }
+    VM_CASE(BRNEG) { VM_BRANCH(reinterpret_cast<LaneInt&>(acc) < 0); }
+    VM_CASE(BRZNEG) { VM_BRANCH(reinterpret_cast<LaneInt&>(acc) <= 0); }
+    VM_CASE(BRPOS) { VM_BRANCH(reinterpret_cast<LaneInt&>(acc) > 0); }
+    VM_CASE(BRZPOS) { VM_BRANCH(reinterpret_cast<LaneInt&>(acc) >= 0); }
+    VM_CASE(BRZERO) { VM_BRANCH(reinterpret_cast<LaneInt&>(acc) == 0); }
+    VM_CASE(NOOP) { VM_NEXT(); }
+    VM_CASE(STOP) {
+        freed = active;
+        active = 0;
+        goto refill;
+    }
+
+divide:
+    // no vector integer division, but doubles divide 32-bit values exactly and truncate
+    // toward zero like the interpreter; -1 is negation (INT_MIN / -1 wraps)
+    {
+        LaneInt divisor = (LaneInt)operand;
+        LaneVec zero = (LaneVec)(divisor == 0) & activeVec & laneBit;
+        taken = 0;
+        for (unsigned l = 0; l < BATCH_LANES; ++l) taken |= zero[l];
+        if (!taken) {
+            LaneInt usable = divisor == 0 || divisor == -1 ? LaneInt{} + 1 : divisor;
+            LaneDouble quotient = __builtin_convertvector((LaneInt)acc, LaneDouble) /
+                                  __builtin_convertvector(usable, LaneDouble);
+            LaneInt result = divisor == -1 ? (LaneInt)(0u - acc) : __builtin_convertvector(quotient, LaneInt);
+            acc = BLEND(activeVec, (LaneVec)result, acc);
+            VM_NEXT();
+        }
+    }
+    // lanes dividing by zero stop with the interpreter's error
+    LANES(active, l) {
+        int32_t dividend = static_cast<int32_t>(acc[l]), divisor = static_cast<int32_t>(operand[l]);
+        if (divisor == 0) {
+            VM_FAIL(l, "DIV: division by zero");
+            continue;
+        }
+        acc[l] = static_cast<uint32_t>(divisor == -1 ? 0u - static_cast<uint32_t>(dividend) : dividend / divisor);
+    }
+    if (error) goto failed;
+    VM_NEXT();
+
+failed:
+    // the lanes that failed take new records, the rest carry on at the next instruction
+    error = nullptr;
+    ++ip;
+park:
+    split = false;
+    LANES(active, l) pc[l] = ip - code;
+    parked |= active;
+    active = 0;
+refill:
+    // start the next records in the freed lanes, from the first instruction
+    LANES(freed, l) {
+        if (next == records.size()) break;
+        record[l] = next++;
+        consumed[l] = 0;
+        acc[l] = 0;
+        for (size_t c = 0; c < image.memory.size(); ++c) mem[c][l] = static_cast<uint32_t>(image.memory[c]);
+        pc[l] = 0;
+        parked |= 1u << l;
+    }
+    freed = 0;
+    candidates = parked;
+select:
+    // run the candidate lanes at the lowest pc
+    split = false;
+    if (!candidates) return;
+    {
+        int32_t lowest = INT_MAX;
+        LANES(candidates, l) lowest = std::min(lowest, pc[l]);
+        ip = code + lowest;
+    }
+absorb:
+    // pick up the lanes parked at ip, and find where the next ones wait
+    if (split) {
+        active |= parked;
+        parked = 0;
+        activeVec |= parkedVec;
+        waitPc = INT_MAX;
+        split = false;
+        VM_DISPATCH();
+    }
+    waitPc = INT_MAX;
+    LANES(parked, l) {
+        if (pc[l] == ip - code) {
+            active |= 1u << l;
+            parked &= ~(1u << l);
+        } else if (pc[l] > ip - code) {
+            waitPc = std::min(waitPc, pc[l]);
+        }
+    }
+    for (unsigned l = 0; l < BATCH_LANES; ++l) activeVec[l] = (active >> l & 1) ? ~0u : 0u;
+    VM_DISPATCH();
+
+backedge:
+    // a loop jumped back while lanes are parked: lanes waiting past the loop run first, so
+    // they reach STOP and take new records, which then join the loop where it restarts
+    split = false;
+    beyond = 0;
+    LANES(parked, l) if (pc[l] > from) beyond |= 1u << l;
+    if (beyond) {
+        LANES(active, l) pc[l] = ip - code;
+        parked |= active;
+        active = 0;
+        candidates = beyond;
+        goto select;
+    }
+    goto absorb;
+#undef LANES
+#undef BLEND
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NEXT
+#undef VM_GOTO
+#undef VM_ARITH
+#undef VM_BRANCH
+#undef VM_FAIL
+}
+
+std::vector<BatchResult> runBatch(const VMImage& image, const std::vector<std::vector<int32_t>>& records,
+                                  bool serial) {
+    std::vector<BatchResult> results(records.size());
+    if (serial) {
+        for (size_t i = 0; i < records.size(); ++i) runSerial(image, records[i], results[i]);
+        return results;
+    }
+    // cells as LaneVecs, aligned for whole-vector loads and stores. alignof(LaneVec) here
+    // is only what the baseline target needs (16 on x86-64), less than the AVX2 clone's
+    size_t cells = std::max<size_t>(image.memory.size(), 1);
+    size_t space = (cells + 1) * sizeof(LaneVec);
+    std::unique_ptr<char[]> storage(new char[space]);
+    void* base = storage.get();
+    LaneVec* mem = static_cast<LaneVec*>(std::align(sizeof(LaneVec), cells * sizeof(LaneVec), base, space));
+    runLanes(image, mem, records, results);
+    return results;
+}
+
+const char* batchTarget() {
+#if defined(__x86_64__) && !defined(__clang__)
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#else
+    return "generic";
+#endif
+}
+
+#else
+
+std::vector<BatchResult> runBatch(const VMImage& image, const std::vector<std::vector<int32_t>>& records,
+                                  bool) {
+    std::vector<BatchResult> results(records.size());
+    for (size_t i = 0; i < records.size(); ++i) runSerial(image, records[i], results[i]);
+    return results;
+}
+
+const char* batchTarget() {
+    return "serial";
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vm.h"
+
+// runs one program over many independent input records in lockstep: BATCH_LANES records
+// at a time share one instruction stream, every lane with its own ACC and cells held side
+// by side in vector registers. lanes that branch apart are parked until the others reach
+// them, and a lane whose record finishes starts the next one (see runLanes).
+
+// records run at once (the vector executor works on this many 32-bit lanes)
+const unsigned BATCH_LANES = 16;
+
+// outcome of one record, as runProgram would have produced it
+struct BatchResult {
+    bool ok = true;
+    std::string error;
+    std::vector<int32_t> output;    // values written, in order
+};
+
+// run image once per record (the values its READs consume, in order); results are in
+// record order. serial runs the records one after another through runProgram instead
+std::vector<BatchResult> runBatch(const VMImage& image, const std::vector<std::vector<int32_t>>& records,
+                                  bool serial = false);
+
+// instruction set the vector executor runs on this machine: "avx2" or "sse2" on x86-64,
+// "generic" elsewhere, "serial" without compiler vector support (every record then goes
+// through runProgram)
+const char* batchTarget();
+
+#endif
@@ -0,0 +1,81 @@
+READ xa
+READ xb
+LOAD xa
+STORE xm
+STORE t0
+LOAD xb
+SUB t0
+BRZNEG L0
+LOAD xb
+STORE xm
+L0: LOAD xm
+STORE t1
+WRITE t1
+LOAD xb
+STORE t2
+LOAD xa
+SUB t2
+BRNEG L1
+BRPOS L1
+LOAD 0
+STORE t3
+WRITE t3
+L1: LOAD xb
+STORE t4
+LOAD xa
+SUB t4
+BRZPOS L3
+LOAD 100
+STORE t5
+LOAD xb
+SUB t5
+BRZPOS L3
+LOAD 1
+STORE t6
+WRITE t6
+L3: LOAD 0
+STORE t7
+LOAD xa
+SUB t7
+BRNEG L5
+LOAD 0
+STORE t8
+LOAD xb
+SUB t8
+BRPOS L5
+LOAD 2
+STORE t9
+WRITE t9
+LOAD xb
+STORE t10
+LOAD xa
+SUB t10
+STORE t11
+WRITE t11
+L5: LOAD 5
+STORE t12
+LOAD xa
+SUB t12
+BRNEG L6
+BRPOS L6
+LOAD 5
+STORE t13
+WRITE t13
+L6: STOP
+xa 0
+xb 0
+xm 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t13 0
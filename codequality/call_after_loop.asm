@@ -0,0 +1,45 @@
+LOAD xi
+MULT 3
+ADD xs
+STORE xs
+LOAD xi
+ADD 1
+STORE xi
+LOAD 3
+STORE t0
+BR L1
+L0: LOAD t0
+ADD xs
+STORE xs
+LOAD xi
+ADD 1
+STORE xi
+LOAD t0
+ADD 3
+STORE t0
+ADD xs
+STORE xs
+LOAD xi
+ADD 1
+STORE xi
+LOAD t0
+ADD 3
+STORE t0
+L1: LOAD 5
+STORE t1
+LOAD xi
+SUB t1
+BRNEG L0
+LOAD xi
+STORE t2
+WRITE t2
+LOAD xs
+STORE t3
+WRITE t3
+STOP
+xi 0
+xs 0
+t0 0
+t1 0
+t2 0
+t3 0
@@ -0,0 +1,25 @@
+READ xb
+LOAD 3
+STORE t0
+LOAD xb
+ADD t0
+STORE xa
+STORE t1
+WRITE t1
+LOAD 4
+STORE t2
+LOAD xa
+SUB t2
+BRZNEG L0
+LOAD xa
+STORE xb
+L0: LOAD xb
+STORE t3
+WRITE t3
+STOP
+xa 1
+xb 2
+t0 0
+t1 0
+t2 0
+t3 0
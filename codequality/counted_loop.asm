@@ -0,0 +1,93 @@
+LOAD 1
+STORE t0
+LOAD xi
+ADD t0
+STORE xi
+LOAD 25
+STORE t1
+LOAD xi
+DIV t1
+STORE t2
+WRITE t2
+BR L1
+L0: LOAD 1
+STORE t3
+LOAD xi
+ADD t3
+STORE xi
+LOAD 25
+STORE t4
+LOAD xi
+DIV t4
+STORE t5
+WRITE t5
+LOAD 1
+STORE t6
+LOAD xi
+ADD t6
+STORE xi
+LOAD 25
+STORE t7
+LOAD xi
+DIV t7
+STORE t8
+WRITE t8
+LOAD 1
+STORE t9
+LOAD xi
+ADD t9
+STORE xi
+LOAD 25
+STORE t10
+LOAD xi
+DIV t10
+STORE t11
+WRITE t11
+LOAD 1
+STORE t12
+LOAD xi
+ADD t12
+STORE xi
+LOAD 25
+STORE t13
+LOAD xi
+DIV t13
+STORE t14
+WRITE t14
+LOAD 1
+STORE t15
+LOAD xi
+ADD t15
+STORE xi
+LOAD 25
+STORE t16
+LOAD xi
+DIV t16
+STORE t17
+WRITE t17
+L1: LOAD 100
+STORE t18
+LOAD xi
+SUB t18
+BRZNEG L0
+STOP
+xi 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t13 0
+t14 0
+t15 0
+t16 0
+t17 0
+t18 0
@@ -0,0 +1,8 @@
+LOAD 6
+STORE xa
+LOAD xa
+STORE t1
+WRITE t1
+STOP
+xa 1
+t1 0
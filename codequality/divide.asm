@@ -0,0 +1,11 @@
+READ xa
+LOAD xa
+STORE t0
+LOAD 5
+DIV t0
+STORE t1
+WRITE t1
+STOP
+xa 0
+t0 0
+t1 0
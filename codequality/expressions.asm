@@ -0,0 +1,109 @@
+READ xa
+READ xb
+LOAD 3
+STORE t0
+LOAD xa
+SUB t0
+STORE t1
+LOAD xb
+STORE t2
+LOAD xa
+ADD t2
+MULT t1
+STORE t3
+WRITE t3
+LOAD xb
+STORE t4
+LOAD 0
+SUB t4
+STORE t5
+LOAD xa
+SUB t5
+STORE t6
+LOAD 0
+SUB t6
+STORE t7
+WRITE t7
+LOAD xb
+STORE t8
+LOAD xa
+SUB t8
+STORE t9
+LOAD 3
+STORE t10
+LOAD xb
+DIV t10
+SUB t9
+STORE t11
+LOAD 2
+STORE t12
+LOAD xa
+MULT t12
+ADD t11
+STORE t13
+WRITE t13
+LOAD xb
+STORE t14
+LOAD xa
+ADD t14
+STORE t15
+LOAD 1
+STORE t16
+LOAD xb
+ADD t16
+MULT t15
+STORE t17
+LOAD xa
+DIV t17
+STORE t18
+WRITE t18
+LOAD 3
+STORE t19
+LOAD xb
+ADD t19
+STORE t20
+LOAD xa
+ADD t20
+STORE t21
+LOAD 2
+STORE t22
+LOAD xb
+ADD t22
+STORE t23
+LOAD 1
+STORE t24
+LOAD xa
+ADD t24
+MULT t23
+DIV t21
+STORE t25
+WRITE t25
+STOP
+xa 0
+xb 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t13 0
+t14 0
+t15 0
+t16 0
+t17 0
+t18 0
+t19 0
+t20 0
+t21 0
+t22 0
+t23 0
+t24 0
+t25 0
@@ -0,0 +1,74 @@
+READ xa
+LOAD 0
+STORE r0
+BR L0
+L1: NOOP
+LOAD 0
+STORE r1
+BR L2
+L3: NOOP
+LOAD 0
+STORE r2
+BR L4
+L5: NOOP
+LOAD 1
+STORE r0
+BR L0
+L6: NOOP
+LOAD xa
+STORE t0
+WRITE t0
+LOAD xb
+STORE t1
+WRITE t1
+LOAD xc
+STORE t2
+WRITE t2
+BR L8
+L0: NOOP
+LOAD 1
+STORE t3
+LOAD xa
+ADD t3
+STORE xa
+LOAD 1
+STORE r2
+BR L4
+L7: NOOP
+LOAD r0
+BRZERO L1
+BR L6
+L2: NOOP
+LOAD xa
+STORE t4
+LOAD xb
+ADD t4
+STORE xb
+BR L3
+L4: NOOP
+LOAD 1
+STORE t5
+LOAD xb
+ADD t5
+STORE t6
+LOAD xc
+ADD t6
+STORE xc
+LOAD r2
+BRZERO L5
+BR L7
+L8: NOOP
+STOP
+xa 0
+xb 0
+xc 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+r0 0
+r1 0
+r2 0
@@ -0,0 +1,275 @@
+READ xk
+LOAD 0
+STORE t0
+LOAD xk
+STORE t2
+LOAD xi
+STORE t3
+LOAD xb
+ADD t3
+MULT t2
+STORE t1
+LOAD xk
+STORE t4
+BR L1
+L0: LOAD t0
+STORE t5
+LOAD xs
+ADD t5
+STORE xs
+LOAD t1
+STORE t6
+LOAD xt
+ADD t6
+STORE xt
+LOAD t0
+ADD 4
+STORE t0
+LOAD t1
+ADD t4
+STORE t1
+LOAD t0
+STORE t7
+LOAD xs
+ADD t7
+STORE xs
+LOAD t1
+STORE t8
+LOAD xt
+ADD t8
+STORE xt
+LOAD t0
+ADD 4
+STORE t0
+LOAD t1
+ADD t4
+STORE t1
+L1: LOAD t0
+SUB 200
+BRNEG L0
+LOAD xs
+STORE t9
+WRITE t9
+LOAD xt
+STORE t10
+WRITE t10
+LOAD 0
+STORE xi
+LOAD 7
+STORE t11
+LOAD xi
+MULT t11
+STORE t12
+WRITE t12
+LOAD 21
+STORE t14
+BR L3
+L2: LOAD t14
+STORE t15
+WRITE t15
+ADD 21
+STORE t16
+WRITE t16
+ADD 21
+STORE t17
+WRITE t17
+ADD 21
+STORE t18
+WRITE t18
+ADD 21
+STORE t19
+WRITE t19
+ADD 21
+STORE t14
+L3: SUB 210
+BRZNEG L2
+LOAD 100
+STORE t20
+LOAD 2
+MULT t20
+STORE t21
+LOAD xs
+SUB t21
+STORE xs
+LOAD 192
+STORE t23
+BR L5
+L4: STORE t24
+LOAD xs
+SUB t24
+STORE xs
+LOAD t23
+SUB 8
+STORE t23
+STORE t25
+LOAD xs
+SUB t25
+STORE xs
+LOAD t23
+SUB 8
+STORE t23
+STORE t26
+LOAD xs
+SUB t26
+STORE xs
+LOAD t23
+SUB 8
+STORE t23
+STORE t27
+LOAD xs
+SUB t27
+STORE xs
+LOAD t23
+SUB 8
+STORE t23
+L5: BRPOS L4
+LOAD xs
+STORE t28
+WRITE t28
+LOAD xk
+STORE t29
+LOAD xj
+STORE t30
+LOAD 0
+SUB t30
+MULT t29
+STORE t31
+LOAD xt
+ADD t31
+STORE xt
+LOAD xj
+STORE t32
+LOAD 2
+ADD t32
+STORE xj
+LOAD xk
+STORE t33
+LOAD xj
+STORE t34
+LOAD 0
+SUB t34
+MULT t33
+STORE t35
+LOAD xt
+ADD t35
+STORE xt
+LOAD xj
+STORE t36
+LOAD 2
+ADD t36
+STORE xj
+LOAD xk
+STORE t38
+LOAD xj
+STORE t39
+LOAD 0
+SUB t39
+MULT t38
+STORE t37
+LOAD xk
+MULT 2
+STORE t40
+LOAD 0
+SUB t40
+STORE t40
+BR L7
+L6: LOAD t37
+STORE t41
+LOAD xt
+ADD t41
+STORE xt
+LOAD xj
+STORE t42
+LOAD 2
+ADD t42
+STORE xj
+LOAD t37
+ADD t40
+STORE t37
+STORE t43
+LOAD xt
+ADD t43
+STORE xt
+LOAD xj
+STORE t44
+LOAD 2
+ADD t44
+STORE xj
+LOAD t37
+ADD t40
+STORE t37
+STORE t45
+LOAD xt
+ADD t45
+STORE xt
+LOAD xj
+STORE t46
+LOAD 2
+ADD t46
+STORE xj
+LOAD t37
+ADD t40
+STORE t37
+L7: LOAD 40
+STORE t47
+LOAD xj
+SUB t47
+BRNEG L6
+BRPOS L6
+LOAD xt
+STORE t48
+WRITE t48
+STOP
+xb 3
+xi 0
+xj 0
+xk 0
+xs 0
+xt 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t14 0
+t15 0
+t16 0
+t17 0
+t18 0
+t19 0
+t20 0
+t21 0
+t23 0
+t24 0
+t25 0
+t26 0
+t27 0
+t28 0
+t29 0
+t30 0
+t31 0
+t32 0
+t33 0
+t34 0
+t35 0
+t36 0
+t37 0
+t38 0
+t39 0
+t40 0
+t41 0
+t42 0
+t43 0
+t44 0
+t45 0
+t46 0
+t47 0
+t48 0
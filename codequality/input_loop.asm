@@ -0,0 +1,55 @@
+READ xn
+BR L1
+L0: LOAD 7
+STORE t0
+LOAD xi
+DIV t0
+STORE xm
+LOAD xi
+STORE t1
+LOAD 3
+SUB t1
+STORE t2
+LOAD xm
+STORE t3
+LOAD xs
+ADD t3
+MULT t2
+STORE xs
+LOAD 100000
+STORE t4
+LOAD xs
+SUB t4
+BRZNEG L2
+LOAD 100000
+STORE t5
+LOAD xs
+SUB t5
+STORE xs
+L2: LOAD 1
+STORE t6
+LOAD xi
+ADD t6
+STORE xi
+L1: LOAD xn
+STORE t7
+LOAD xi
+SUB t7
+BRNEG L0
+LOAD xs
+STORE t8
+WRITE t8
+STOP
+xi 0
+xm 0
+xn 0
+xs 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
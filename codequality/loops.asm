@@ -0,0 +1,317 @@
+BR L1
+L0: LOAD xi
+STORE t0
+LOAD xs
+ADD t0
+STORE xs
+LOAD 1
+STORE t1
+LOAD xi
+ADD t1
+STORE xi
+STORE t2
+LOAD xs
+ADD t2
+STORE xs
+LOAD 1
+STORE t3
+LOAD xi
+ADD t3
+STORE xi
+STORE t4
+LOAD xs
+ADD t4
+STORE xs
+LOAD 1
+STORE t5
+LOAD xi
+ADD t5
+STORE xi
+STORE t6
+LOAD xs
+ADD t6
+STORE xs
+LOAD 1
+STORE t7
+LOAD xi
+ADD t7
+STORE xi
+L1: LOAD 8
+STORE t8
+LOAD xi
+SUB t8
+BRNEG L0
+LOAD xs
+STORE t9
+WRITE t9
+LOAD 20
+STORE xj
+BR L3
+L2: LOAD 1
+STORE t10
+LOAD xt
+ADD t10
+STORE xt
+LOAD 3
+STORE t11
+LOAD xj
+SUB t11
+STORE xj
+BR L5
+L4: LOAD 1
+STORE t12
+LOAD xw
+ADD t12
+STORE xw
+L5: LOAD 2
+STORE t13
+LOAD xw
+SUB t13
+BRNEG L4
+LOAD 1
+STORE t14
+LOAD xt
+ADD t14
+STORE xt
+LOAD 3
+STORE t15
+LOAD xj
+SUB t15
+STORE xj
+BR L7
+L6: LOAD 1
+STORE t16
+LOAD xw
+ADD t16
+STORE xw
+L7: LOAD 2
+STORE t17
+LOAD xw
+SUB t17
+BRNEG L6
+L3: LOAD 2
+STORE t18
+LOAD xj
+SUB t18
+BRPOS L2
+LOAD xt
+STORE t19
+WRITE t19
+LOAD xj
+STORE t20
+WRITE t20
+LOAD 0
+STORE xi
+LOAD 1
+STORE t21
+LOAD xi
+ADD t21
+STORE xi
+LOAD 25
+STORE t22
+LOAD xi
+DIV t22
+STORE t23
+WRITE t23
+BR L9
+L8: LOAD 1
+STORE t24
+LOAD xi
+ADD t24
+STORE xi
+LOAD 25
+STORE t25
+LOAD xi
+DIV t25
+STORE t26
+WRITE t26
+LOAD 1
+STORE t27
+LOAD xi
+ADD t27
+STORE xi
+LOAD 25
+STORE t28
+LOAD xi
+DIV t28
+STORE t29
+WRITE t29
+LOAD 1
+STORE t30
+LOAD xi
+ADD t30
+STORE xi
+LOAD 25
+STORE t31
+LOAD xi
+DIV t31
+STORE t32
+WRITE t32
+LOAD 1
+STORE t33
+LOAD xi
+ADD t33
+STORE xi
+LOAD 25
+STORE t34
+LOAD xi
+DIV t34
+STORE t35
+WRITE t35
+LOAD 1
+STORE t36
+LOAD xi
+ADD t36
+STORE xi
+LOAD 25
+STORE t37
+LOAD xi
+DIV t37
+STORE t38
+WRITE t38
+L9: LOAD 100
+STORE t39
+LOAD xi
+SUB t39
+BRZNEG L8
+LOAD 0
+STORE t40
+LOAD 5
+ADD t40
+STORE t41
+LOAD 5
+ADD t41
+STORE t42
+LOAD 5
+ADD t42
+STORE t43
+LOAD 5
+ADD t43
+STORE t44
+LOAD 5
+ADD t44
+STORE t45
+LOAD 5
+ADD t45
+STORE t46
+LOAD 5
+ADD t46
+STORE t47
+LOAD 5
+ADD t47
+STORE xi
+BR L11
+L10: LOAD xi
+STORE t48
+LOAD 5
+ADD t48
+STORE t49
+LOAD 5
+ADD t49
+STORE t50
+LOAD 5
+ADD t50
+STORE t51
+LOAD 5
+ADD t51
+STORE t52
+LOAD 5
+ADD t52
+STORE t53
+LOAD 5
+ADD t53
+STORE t54
+LOAD 5
+ADD t54
+STORE t55
+LOAD 5
+ADD t55
+STORE t56
+LOAD 5
+ADD t56
+STORE t57
+LOAD 5
+ADD t57
+STORE t58
+LOAD 5
+ADD t58
+STORE t59
+LOAD 5
+ADD t59
+STORE xi
+L11: LOAD 1000
+STORE t60
+LOAD xi
+SUB t60
+BRNEG L10
+LOAD xi
+STORE t61
+WRITE t61
+STOP
+xi 0
+xj 0
+xs 0
+xt 0
+xw 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t13 0
+t14 0
+t15 0
+t16 0
+t17 0
+t18 0
+t19 0
+t20 0
+t21 0
+t22 0
+t23 0
+t24 0
+t25 0
+t26 0
+t27 0
+t28 0
+t29 0
+t30 0
+t31 0
+t32 0
+t33 0
+t34 0
+t35 0
+t36 0
+t37 0
+t38 0
+t39 0
+t40 0
+t41 0
+t42 0
+t43 0
+t44 0
+t45 0
+t46 0
+t47 0
+t48 0
+t49 0
+t50 0
+t51 0
+t52 0
+t53 0
+t54 0
+t55 0
+t56 0
+t57 0
+t58 0
+t59 0
+t60 0
+t61 0
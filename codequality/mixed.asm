@@ -0,0 +1,130 @@
+READ xn
+BR L2
+L0: LOAD xk
+STORE t0
+LOAD xr
+MULT t0
+STORE xr
+LOAD 1
+STORE t1
+LOAD xk
+ADD t1
+STORE xk
+LOAD 1000
+STORE t2
+LOAD xr
+SUB t2
+BRNEG L2
+LOAD xr
+STORE t3
+WRITE t3
+L2: LOAD xn
+STORE t4
+LOAD xk
+SUB t4
+BRZNEG L0
+LOAD xr
+STORE t5
+WRITE t5
+LOAD 2
+STORE t6
+LOAD 4
+DIV t6
+STORE xu
+LOAD 1
+STORE t7
+LOAD xu
+SUB t7
+STORE t8
+LOAD 0
+SUB t8
+STORE t9
+WRITE t9
+LOAD 2
+STORE t10
+LOAD 3
+DIV t10
+STORE t11
+LOAD 2
+STORE t12
+LOAD xn
+ADD t12
+MULT t11
+STORE t13
+WRITE t13
+LOAD 3
+STORE t14
+LOAD xj
+SUB t14
+STORE xj
+STORE t15
+WRITE t15
+LOAD 3
+STORE t16
+LOAD xj
+SUB t16
+STORE xj
+STORE t17
+WRITE t17
+LOAD 3
+STORE t18
+LOAD xj
+SUB t18
+STORE xj
+STORE t19
+WRITE t19
+LOAD 3
+STORE t20
+LOAD xj
+SUB t20
+STORE t21
+WRITE t21
+LOAD 1
+STORE t22
+LOAD xz
+SUB t22
+STORE xz
+LOAD 1
+STORE t23
+LOAD xz
+SUB t23
+STORE xz
+LOAD 1
+STORE t24
+LOAD xz
+SUB t24
+STORE t25
+WRITE t25
+STOP
+xj 10
+xk 1
+xn 0
+xr 1
+xu 9
+xz 3
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t13 0
+t14 0
+t15 0
+t16 0
+t17 0
+t18 0
+t19 0
+t20 0
+t21 0
+t22 0
+t23 0
+t24 0
+t25 0
@@ -0,0 +1,47 @@
+READ xn
+BR L1
+L2: LOAD 3
+STORE t0
+LOAD xj
+SUB t0
+BRZERO L4
+LOAD xj
+STORE t1
+LOAD xt
+ADD t1
+STORE xt
+L4: LOAD 1
+STORE t2
+LOAD xj
+ADD t2
+STORE xj
+L3: LOAD xi
+STORE t3
+LOAD xj
+SUB t3
+BRNEG L2
+LOAD 1
+STORE t4
+LOAD xi
+ADD t4
+STORE xi
+L1: LOAD xn
+STORE t5
+LOAD xi
+SUB t5
+BRNEG L3
+LOAD xt
+STORE t6
+WRITE t6
+STOP
+xi 0
+xj 0
+xn 0
+xt 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
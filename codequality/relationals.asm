@@ -0,0 +1,142 @@
+BR L1
+L0: LOAD 2
+STORE t0
+LOAD xi
+STORE t1
+LOAD xs
+ADD t1
+MULT t0
+STORE xs
+LOAD 1
+STORE t2
+LOAD xi
+ADD t2
+STORE xi
+LOAD 2
+STORE t3
+LOAD xi
+STORE t4
+LOAD xs
+ADD t4
+MULT t3
+STORE xs
+LOAD 1
+STORE t5
+LOAD xi
+ADD t5
+STORE xi
+LOAD 2
+STORE t6
+LOAD xi
+STORE t7
+LOAD xs
+ADD t7
+MULT t6
+STORE xs
+LOAD 1
+STORE t8
+LOAD xi
+ADD t8
+STORE xi
+LOAD 2
+STORE t9
+LOAD xi
+STORE t10
+LOAD xs
+ADD t10
+MULT t9
+STORE xs
+LOAD 1
+STORE t11
+LOAD xi
+ADD t11
+STORE xi
+L1: LOAD 8
+STORE t12
+LOAD xi
+SUB t12
+BRNEG L0
+LOAD xs
+STORE t13
+WRITE t13
+READ xa
+LOAD 3
+STORE t14
+LOAD xa
+SUB t14
+BRZNEG L2
+LOAD xa
+STORE t15
+WRITE t15
+L2: LOAD 3
+STORE t16
+LOAD xa
+SUB t16
+BRZERO L3
+LOAD 1
+STORE t17
+WRITE t17
+L3: LOAD 7
+STORE t18
+LOAD xa
+SUB t18
+BRNEG L4
+BRPOS L4
+LOAD 3
+STORE t19
+WRITE t19
+L4: LOAD 7
+STORE t20
+LOAD xa
+SUB t20
+BRPOS L5
+LOAD 4
+STORE t21
+WRITE t21
+L5: LOAD 7
+STORE t22
+LOAD xa
+SUB t22
+BRNEG L6
+LOAD 5
+STORE t23
+WRITE t23
+L6: LOAD 7
+STORE t24
+LOAD xa
+SUB t24
+BRNEG L7
+BRPOS L7
+LOAD 6
+STORE t25
+WRITE t25
+L7: STOP
+xa 5
+xi 0
+xs 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+t12 0
+t13 0
+t14 0
+t15 0
+t16 0
+t17 0
+t18 0
+t19 0
+t20 0
+t21 0
+t22 0
+t23 0
+t24 0
+t25 0
@@ -0,0 +1,94 @@
+READ xa
+LOAD 0
+STORE r1
+BR L0
+L1: LOAD 1
+STORE t0
+LOAD xa
+ADD t0
+STORE xa
+LOAD 1
+STORE r1
+BR L0
+L2: LOAD 2
+STORE r1
+BR L0
+L3: LOAD xa
+STORE t1
+WRITE t1
+LOAD 3
+STORE t2
+LOAD xa
+SUB t2
+BRZNEG L5
+LOAD 3
+STORE r1
+BR L0
+L5: LOAD xb
+STORE t3
+WRITE t3
+BR L9
+L0: LOAD 0
+STORE xi
+STORE xs
+BR L7
+L6: LOAD xi
+STORE t4
+STORE t5
+LOAD xs
+ADD t5
+MULT t4
+STORE xs
+LOAD 50
+STORE t6
+LOAD xs
+SUB t6
+BRZNEG L8
+LOAD 50
+STORE t7
+LOAD xs
+SUB t7
+STORE xs
+L8: LOAD 1
+STORE t8
+LOAD xi
+ADD t8
+STORE xi
+L7: LOAD xa
+STORE t9
+LOAD xi
+SUB t9
+BRNEG L6
+LOAD xs
+STORE t10
+WRITE t10
+LOAD 1
+STORE t11
+LOAD xa
+ADD t11
+STORE xa
+LOAD r1
+BRZERO L1
+SUB 1
+BRZERO L2
+SUB 1
+BRZERO L3
+BR L5
+L9: STOP
+xa 0
+xb 0
+xi 0
+xs 0
+t0 0
+t1 0
+t2 0
+t3 0
+t4 0
+t5 0
+t6 0
+t7 0
+t8 0
+t9 0
+t10 0
+t11 0
+r1 0
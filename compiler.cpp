@@ -1,254 +1,1677 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
 #include "node.h"
 #include "token.h"
 #include "compiler.h"
+#include "timing.h"
+#include "threadPool.h"
 
-// create temporary variable names
-static int tempVarCounter = 0;
+// create temporary variable names (per thread: parallel codegen numbers each chunk from 0)
+static thread_local int tempVarCounter = 0;
 std::string createTempVar() {
     return "t" + std::to_string(tempVarCounter++);
 }
 
 // create labels for branching
-static int labelCounter = 0;
+static thread_local int labelCounter = 0;
 std::string createLabel() {
     return "L" + std::to_string(labelCounter++);
 }
 
+// code generation tunables (set by traversal)
+static CodegenOptions options;
+
+// values of variables known at the current point of code generation
+static thread_local std::map<std::string, int> knownValues;
+
+// iterations per entry of each rotated loop whose trip count was proven, by source line
+// (-1 where emissions of the line disagree); reported in CodegenStats::loopTrips
+static thread_local std::map<int, long long> loopTrips;
+
+static void recordLoopTrips(int line, long long iterations) {
+    auto known = loopTrips.find(line);
+    if (known == loopTrips.end()) loopTrips[line] = iterations;
+    else if (known->second != iterations) known->second = -1;
+}
+
+// profile probes: counter cell per probe name, and the name prefix given to each cond/loop
+static std::map<std::string, std::string> probeCells;
+static std::vector<std::string> probeOrder;
+static std::map<Node*, std::string> probePrefixes;
+static std::map<int, int> probesOnLine;
+
+// then-arms moved out of line by the profile, placed at the end of the program
+static std::vector<Instr> coldCode;
+
+// a subroutine: inlined at every call, or called through its entry label and
+// returned from through a chain that dispatches on the call-site index in its return cell
+struct Subroutine {
+    Node* def = nullptr;            // func node; children[0] is the body block
+    int index = 0;
+    int callSites = 0;              // calls in the source
+    int inlineState = -1;           // -1 undecided, 0 out of line, 1 inlined
+    std::string entryLabel;
+    std::vector<std::string> returnLabels;  // one per emitted call, in call-site index order
+    bool generated = false;
+    std::vector<Instr> code;        // body followed by the return dispatch
+};
+static std::map<std::string, Subroutine> subroutines;
+
+// strength-reduced loops being generated: products replaced by the running cell holding them,
+// what each step statement adds to those cells, and steps of counters that were eliminated
+struct InductionUpdate {
+    std::string cell;
+    long long increment = 0;        // added per step, unless incrementCell is set
+    std::string incrementCell;
+};
+static thread_local std::map<Node*, std::string> reducedProducts;
+static thread_local std::map<Node*, std::vector<InductionUpdate>> inductionUpdates;
+static thread_local std::set<Node*> droppedSteps;
+
+// the main block's statements, and for each variable the positions of the statements that
+// read or write it, for deciding whether a loop counter is read after its loop
+static std::vector<Node*> mainStatements;
+static std::map<Node*, size_t> mainStatementIndex;
+static std::map<std::string, std::vector<size_t>> mainReferences;
+
+// initial values decided by partial evaluation, and cells for negative constants it writes
+static std::map<std::string, int> initialValues;
+static std::map<int, std::string> constantCells;
+
+// a cond arm is laid out of line when the profile shows it taken at most once per
+// COLD_ARM_RATIO skips; a loop body run HOT_LOOP_COUNT times gets HOT_LOOP_BUDGET_SCALE
+// times the unroll budget, and a body that never ran is not unrolled
+static const long long COLD_ARM_RATIO = 4;
+static const long long HOT_LOOP_COUNT = 1000;
+static const int HOT_LOOP_BUDGET_SCALE = 4;
+
 // allocate storage for variables after code generation
-void allocateStorage(STATSEM& statsem, std::ofstream& out) {
+void allocateStorage(STATSEM& statsem, AsmProgram& program) {
     const auto& table = statsem.getVarTable(); // access varTable
     for (const auto& entry : table) { // entry: pair<const string, VarInfo>
         const std::string& name = entry.first;
         const STATSEM::VarInfo& info = entry.second;
-        out << name << " " << info.initValue << "\n"; // allocate with initial value
+        auto computed = initialValues.find(name);
+        // allocate with initial value (or the one partial evaluation computed)
+        program.data.push_back({name, computed != initialValues.end() ? computed->second : info.initValue});
     }
 
+    // negative constants written by partial evaluation
+    for (const auto& entry : constantCells) program.data.push_back({entry.second, entry.first});
+
     // allocate temp variables
     for (int i = 0; i < tempVarCounter; ++i) {
-        out << "t" << i << " 0\n"; // initialize temps to 0
+        program.data.push_back({"t" + std::to_string(i), 0}); // initialize temps to 0
+    }
+
+    // profile counters
+    for (const auto& probe : probeOrder) program.data.push_back({probeCells[probe], 0});
+
+    // return cells of subroutines called out of line
+    for (const auto& entry : subroutines) {
+        if (entry.second.generated) program.data.push_back({"r" + std::to_string(entry.second.index), 0});
+    }
+}
+
+// append an instruction
+static void emit(std::vector<Instr>& out, const std::string& op, const std::string& arg = "") {
+    out.push_back({"", op, arg, 0, ""});
+}
+
+// append a branch target
+static void emitLabel(std::vector<Instr>& out, const std::string& label) {
+    out.push_back({label, "NOOP", "", 0, ""});
+}
+
+// write the program in the target's text format
+void writeAsm(const AsmProgram& program, std::ostream& out) {
+    // build the whole listing and hand it to the stream once
+    std::string text;
+    text.reserve(program.code.size() * 12 + program.data.size() * 12);
+    for (const auto& instr : program.code) {
+        if (!instr.label.empty()) text += instr.label + ": ";
+        text += instr.op;
+        if (!instr.arg.empty()) text += " " + instr.arg;
+        text += "\n";
+    }
+    for (const auto& cell : program.data) {
+        text += cell.name + " " + std::to_string(cell.value) + "\n";
+    }
+    out.write(text.data(), text.size());
+}
+
+void writeLineMap(const AsmProgram& program, std::ostream& out) {
+    // one line per run of instructions from the same statement: first-last line kind
+    std::string text = "# instructions (1-based, as in the .asm) source-line statement-kind\n";
+    for (size_t i = 0; i < program.code.size();) {
+        size_t j = i + 1;
+        while (j < program.code.size() && program.code[j].line == program.code[i].line &&
+               program.code[j].kind == program.code[i].kind) {
+            j++;
+        }
+        if (!program.code[i].kind.empty()) {
+            text += std::to_string(i + 1) + "-" + std::to_string(j) + " " + std::to_string(program.code[i].line) +
+                    " " + program.code[i].kind + "\n";
+        }
+        i = j;
+    }
+    out.write(text.data(), text.size());
+}
+
+// ---------------------------------------------------------------------------
+// loop analysis (constant trip counts for unrolling, induction variables)
+// ---------------------------------------------------------------------------
+
+static const long long VALUE_LIMIT = 2147483647LL; // keep folded values in int range
+
+// relational operator token stored in children[0] of a cond/loop node
+static std::string relationalToken(Node* root) {
+    if (root->children.empty() || !root->children[0] || root->children[0]->tokens.empty()) return "";
+    return root->children[0]->tokens[0];
+}
+
+// branch lowering for each relational operator in relational(); ACC holds lhs - rhs.
+// every relation except equality needs a single branch in either sense.
+struct RelationalLowering {
+    const char* op;
+    const char* whenTrue[2];   // branches taken exactly when the relation holds
+    const char* whenFalse[2];  // branches taken exactly when it fails
+};
+
+static const RelationalLowering relationalTable[] = {
+    {"?lt", {"BRNEG", nullptr},  {"BRZPOS", nullptr}},
+    {"?le", {"BRZNEG", nullptr}, {"BRPOS", nullptr}},
+    {"?gt", {"BRPOS", nullptr},  {"BRZNEG", nullptr}},
+    {"?ge", {"BRZPOS", nullptr}, {"BRNEG", nullptr}},
+    {"?eq", {"BRZERO", nullptr}, {"BRNEG", "BRPOS"}},
+    {"= =", {"BRZERO", nullptr}, {"BRNEG", "BRPOS"}},
+    {"?ne", {"BRNEG", "BRPOS"},  {"BRZERO", nullptr}},
+    {";",   {"BRNEG", "BRPOS"},  {"BRZERO", nullptr}},
+};
+
+static const RelationalLowering& lowerRelational(const std::string& relTok) {
+    for (const auto& entry : relationalTable) {
+        if (relTok == entry.op) return entry;
+    }
+    std::cerr << "ERROR in P4: Unknown relational operator '" << relTok << "'.\n";
+    exit(EXIT_FAILURE);
+}
+
+// whether the relation holds for ACC = lhs - rhs
+static bool relationHolds(const std::string& relTok, long long acc) {
+    const RelationalLowering& lowering = lowerRelational(relTok);
+    for (const char* branch : lowering.whenTrue) {
+        if (!branch) continue;
+        std::string op = branch;
+        if ((op == "BRNEG" && acc < 0) || (op == "BRZNEG" && acc <= 0) || (op == "BRPOS" && acc > 0) ||
+            (op == "BRZPOS" && acc >= 0) || (op == "BRZERO" && acc == 0)) return true;
     }
+    return false;
 }
 
-// traversal implementation
-static void traversal_impl(Node* root, std::ofstream& out) {
+// fold an expression subtree using the given variable values; false if any operand is unknown
+static bool evalConstant(Node* root, const std::map<std::string, int>& env, long long& value) {
+    if (!root) return false;
+    long long lhs = 0, rhs = 0;
+    if (root->kind == NodeKind::R) {
+        if (root->children.size() == 1) return evalConstant(root->children[0], env, value);
+        if (root->tokens.empty()) return false;
+        const std::string& tok = root->tokens[0];
+        if (std::isdigit(static_cast<unsigned char>(tok[0]))) {
+            value = std::stoll(tok);
+            return true;
+        }
+        auto it = env.find(tok);
+        if (it == env.end()) return false;
+        value = it->second;
+        return true;
+    }
+    if (root->kind == NodeKind::N && !root->tokens.empty() && root->children.size() == 1) {
+        // unary minus
+        if (!evalConstant(root->children[0], env, lhs)) return false;
+        value = -lhs;
+        return true;
+    }
+    if (root->tokens.empty() || root->children.size() < 2) {
+        return root->children.size() == 1 && evalConstant(root->children[0], env, value);
+    }
+    if (!evalConstant(root->children[0], env, lhs) || !evalConstant(root->children[1], env, rhs)) return false;
+    const std::string& op = root->tokens[0];
+    if (op == "**") value = lhs * rhs;
+    else if (op == "//") {
+        if (rhs == 0) return false;
+        value = lhs / rhs;
+    }
+    else if (op == "+") value = lhs + rhs;
+    else value = lhs - rhs;
+    return value >= -VALUE_LIMIT && value <= VALUE_LIMIT;
+}
+
+// express an expression subtree as coef * id + offset, folding other operands through env;
+// false if the subtree is not affine in id
+static bool affineIn(Node* root, const std::string& id, const std::map<std::string, int>& env,
+                     long long& coef, long long& offset) {
+    if (!root) return false;
+    if (root->kind == NodeKind::R && root->children.empty()) {
+        if (!root->tokens.empty() && root->tokens[0] == id) {
+            coef = 1;
+            offset = 0;
+            return true;
+        }
+        coef = 0;
+        return evalConstant(root, env, offset);
+    }
+    if (root->tokens.empty() || root->kind == NodeKind::R) {
+        return root->children.size() == 1 && affineIn(root->children[0], id, env, coef, offset);
+    }
+    long long c1 = 0, o1 = 0, c2 = 0, o2 = 0;
+    if (root->children.size() == 1) {
+        // unary minus
+        if (!affineIn(root->children[0], id, env, c1, o1)) return false;
+        coef = -c1;
+        offset = -o1;
+        return true;
+    }
+    if (!affineIn(root->children[0], id, env, c1, o1) || !affineIn(root->children[1], id, env, c2, o2)) return false;
+    const std::string& op = root->tokens[0];
+    if (op == "+") { coef = c1 + c2; offset = o1 + o2; }
+    else if (op == "-") { coef = c1 - c2; offset = o1 - o2; }
+    else if (op == "**" && c1 == 0) { coef = o1 * c2; offset = o1 * o2; }
+    else if (op == "**" && c2 == 0) { coef = c1 * o2; offset = o1 * o2; }
+    else if (op == "//" && c1 == 0 && c2 == 0 && o2 != 0) { coef = 0; offset = o1 / o2; }
+    else return false;
+    return coef >= -VALUE_LIMIT && coef <= VALUE_LIMIT && offset >= -VALUE_LIMIT && offset <= VALUE_LIMIT;
+}
+
+// collect every variable written (set or scan) anywhere in a subtree
+static void collectAssigned(Node* root, std::set<std::string>& assigned) {
     if (!root) return;
-    //std::cout << "Visiting " << root->type << std::endl;
-    // if else to generate code based on node type
-    if (root->type == "read") {
-        // read input into variable
-        std::string varName = root->tokens[0];
-        out << "READ " << varName << "\n";
-    }
-    else if (root->type == "print") {
-        // continue to child to get expression value
-        traversal_impl(root->children[0], out);
-        // store expression result in temp variable
-        std::string tempVar = createTempVar();
-        out << "STORE " << tempVar << "\n";
-        // print the result
-        out << "WRITE " << tempVar << "\n";
+    if ((root->kind == NodeKind::Assign || root->kind == NodeKind::Read) && !root->tokens.empty()) {
+        assigned.insert(root->tokens[0]);
+    }
+    // a call writes whatever the subroutine writes (STATSEM rules out recursion)
+    if (root->kind == NodeKind::Call) {
+        auto sub = subroutines.find(root->tokens[0]);
+        if (sub != subroutines.end()) collectAssigned(sub->second.def->children[0], assigned);
+    }
+    for (auto child : root->children) collectAssigned(child, assigned);
+}
+
+// flatten the straight-line statements of a stat (nested blocks included)
+static void collectStatements(Node* root, std::vector<Node*>& stmts) {
+    if (!root) return;
+    if (root->kind == NodeKind::Stat || root->kind == NodeKind::Stats || root->kind == NodeKind::MStat) {
+        for (auto child : root->children) collectStatements(child, stmts);
+    } else if (root->kind == NodeKind::Block) {
+        if (root->children.size() > 1) collectStatements(root->children[1], stmts);
+    } else {
+        stmts.push_back(root);
     }
-    else if (root->type == "cond") {
-        // cond [ identifier <relational> <exp> ] <stat>
-        if (root->tokens.empty() || root->children.size() < 3) return;
+}
 
-        // evaluate RHS <exp> -> leave result in ACC
-        traversal_impl(root->children[1], out);
-        // save RHS
-        std::string rhsTemp = createTempVar();
-        out << "STORE " << rhsTemp << "\n";
-
-        // load identifier (LHS) and compute LHS - RHS in ACC
-        std::string id = root->tokens[1];
-        out << "LOAD " << id << "\n";
-        out << "SUB " << rhsTemp << "\n";
-
-        // relational operator is stored as a token in children[0]
-        std::string relTok;
-        if (!root->children[0]->tokens.empty()) relTok = root->children[0]->tokens[0];
-
-        std::string trueLabel = createLabel();
-        std::string endLabel  = createLabel();
-
-        if (relTok == ";") {
-            // NOT EQUAL: if ACC == 0 skip stat, else fall through to stat
-            out << "BRZERO " << endLabel << "\n";
-            traversal_impl(root->children[2], out);
-            out << endLabel << ": NOOP\n";
+static int estimateSize(Node* root);
+
+// instructions an out-of-line call takes: LOAD site index, STORE return cell, BR entry
+static const int CALL_SEQUENCE_SIZE = 3;
+
+// cost model: inline when copying the body into every call site grows the code by no more
+// than inlineBudget instructions over one shared copy plus call sequences and return dispatch
+static bool shouldInline(Subroutine& sub) {
+    if (sub.inlineState < 0) {
+        int body = estimateSize(sub.def->children[0]);
+        int calls = sub.callSites;
+        int dispatch = calls <= 1 ? 1 : 2 * calls - 1;
+        int outOfLine = body + dispatch + CALL_SEQUENCE_SIZE * calls;
+        sub.inlineState = options.inlineBudget >= 0 && body * calls - outOfLine <= options.inlineBudget;
+    }
+    return sub.inlineState == 1;
+}
+
+// rough number of instructions traversal_impl emits for a subtree
+static int estimateSize(Node* root) {
+    if (!root) return 0;
+    int size = 0;
+    if (root->kind == NodeKind::Call) {
+        auto sub = subroutines.find(root->tokens[0]);
+        if (sub == subroutines.end()) return 0;
+        return shouldInline(sub->second) ? estimateSize(sub->second.def->children[0]) : CALL_SEQUENCE_SIZE;
+    }
+    if (root->kind == NodeKind::Func) return 0;
+    if (root->kind == NodeKind::Read || root->kind == NodeKind::R) size = 1;
+    else if (root->kind == NodeKind::Print) size = 2;
+    else if (root->kind == NodeKind::Assign) size = 1;
+    else if (root->kind == NodeKind::Cond) size = 5;
+    else if (root->kind == NodeKind::Loop) size = 6;
+    else if (!root->tokens.empty() && (root->kind == NodeKind::Exp || root->kind == NodeKind::M || root->kind == NodeKind::N)) {
+        size = root->children.size() == 1 ? 3 : 2;
+    }
+    for (auto child : root->children) size += estimateSize(child);
+    return size;
+}
+
+// drop the values of every variable a subtree may write
+static void forgetAssigned(Node* root) {
+    std::set<std::string> assigned;
+    collectAssigned(root, assigned);
+    for (const auto& name : assigned) knownValues.erase(name);
+}
+
+// upper bound on iterations simulated when looking for a constant trip count
+static const long long MAX_ANALYZED_TRIPS = 1000000;
+
+// collect every variable read or written anywhere in a subtree
+static void collectReferenced(Node* root, std::set<std::string>& names) {
+    if (!root) return;
+    bool leaf = root->kind == NodeKind::R && root->children.empty();
+    if ((leaf || root->kind == NodeKind::Assign || root->kind == NodeKind::Read) && !root->tokens.empty() &&
+        !std::isdigit(static_cast<unsigned char>(root->tokens[0][0]))) {
+        names.insert(root->tokens[0]);
+    }
+    if ((root->kind == NodeKind::Cond || root->kind == NodeKind::Loop) && root->tokens.size() > 1) {
+        names.insert(root->tokens[1]);
+    }
+    if (root->kind == NodeKind::Call) {
+        auto sub = subroutines.find(root->tokens[0]);
+        if (sub != subroutines.end()) collectReferenced(sub->second.def->children[0], names);
+    }
+    for (auto child : root->children) collectReferenced(child, names);
+}
+
+// values known on entry of the variables a loop mentions but its body never changes
+static std::map<std::string, int> invariantValues(Node* loop) {
+    std::set<std::string> assigned, referenced;
+    collectAssigned(loop->children[2], assigned);
+    collectReferenced(loop, referenced);
+    std::map<std::string, int> invariant;
+    for (const auto& name : referenced) {
+        auto known = knownValues.find(name);
+        if (known != knownValues.end() && !assigned.count(name)) invariant.insert(*known);
+    }
+    return invariant;
+}
+
+// basic induction variable of loop [ id <relational> <exp> ] <stat>: id is written exactly once
+// per iteration, by a top-level id = id + step with a constant step
+static bool basicInductionStep(Node* root, const std::map<std::string, int>& invariant, long long& step,
+                               Node*& stepStmt) {
+    if (root->tokens.size() < 2 || root->children.size() < 3) return false;
+    const std::string& id = root->tokens[1];
+    Node* body = root->children[2];
+
+    int writes = 0;
+    std::function<void(Node*)> countWrites = [&](Node* n) {
+        if (!n) return;
+        if ((n->kind == NodeKind::Assign || n->kind == NodeKind::Read) && !n->tokens.empty() && n->tokens[0] == id) writes++;
+        if (n->kind == NodeKind::Call) {
+            // a write hidden in a subroutine is never the top-level step
+            std::set<std::string> callee;
+            collectAssigned(n, callee);
+            if (callee.count(id)) writes += 2;
+        }
+        for (auto child : n->children) countWrites(child);
+    };
+    countWrites(body);
+    if (writes != 1) return false;
+
+    std::vector<Node*> stmts;
+    collectStatements(body, stmts);
+    for (auto stmt : stmts) {
+        if (stmt->kind != NodeKind::Assign || stmt->tokens[0] != id) continue;
+        long long coef = 0, offset = 0;
+        if (!affineIn(stmt->children[0], id, invariant, coef, offset) || coef != 1 || offset == 0) return false;
+        step = offset;
+        stepStmt = stmt;
+        return true;
+    }
+    return false;
+}
+
+// trip count of loop [ id <relational> <exp> ] <stat> when it can be proven at compile time:
+// id must hold a known value on entry and be a basic induction variable, and the bound must
+// be loop invariant
+static bool constantTripCount(Node* root, long long maxTrips, long long& trips) {
+    if (root->tokens.size() < 2 || root->children.size() < 3) return false;
+    const std::string& id = root->tokens[1];
+
+    auto start = knownValues.find(id);
+    if (start == knownValues.end()) return false;
+
+    std::map<std::string, int> invariant = invariantValues(root);
+    long long bound = 0;
+    if (!evalConstant(root->children[1], invariant, bound)) return false;
+
+    long long step = 0;
+    Node* stepStmt = nullptr;
+    if (!basicInductionStep(root, invariant, step, stepStmt)) return false;
+
+    const std::string relTok = relationalToken(root);
+    long long value = start->second;
+    trips = 0;
+    while (true) {
+        long long diff = value - bound;
+        if (diff < -VALUE_LIMIT || diff > VALUE_LIMIT) return false;
+        if (!relationHolds(relTok, diff)) break;
+        if (++trips > maxTrips) return false;
+        value += step;
+        if (value < -VALUE_LIMIT || value > VALUE_LIMIT) return false;
+    }
+    return true;
+}
+
+// express a subtree as coef * id + (loop-invariant part), coef a constant; false if it reads
+// another variable the loop writes, scales id by a non-constant, or divides by a non-constant
+// (the invariant part is evaluated ahead of the loop, where a zero divisor must not trap)
+static bool inductionCoefficient(Node* root, const std::string& id, const std::set<std::string>& assigned,
+                                 const std::map<std::string, int>& invariant, long long& coef) {
+    if (!root) return false;
+    if (root->kind == NodeKind::R && root->children.empty()) {
+        if (root->tokens.empty()) return false;
+        const std::string& tok = root->tokens[0];
+        coef = tok == id ? 1 : 0;
+        return tok == id || std::isdigit(static_cast<unsigned char>(tok[0])) || !assigned.count(tok);
+    }
+    if (root->tokens.empty() || root->kind == NodeKind::R) {
+        return root->children.size() == 1 && inductionCoefficient(root->children[0], id, assigned, invariant, coef);
+    }
+    long long c1 = 0, c2 = 0, k = 0;
+    if (root->children.size() == 1) {
+        // unary minus
+        if (!inductionCoefficient(root->children[0], id, assigned, invariant, c1)) return false;
+        coef = -c1;
+        return true;
+    }
+    if (!inductionCoefficient(root->children[0], id, assigned, invariant, c1) ||
+        !inductionCoefficient(root->children[1], id, assigned, invariant, c2)) {
+        return false;
+    }
+    const std::string& op = root->tokens[0];
+    if (op == "+") coef = c1 + c2;
+    else if (op == "-") coef = c1 - c2;
+    else if (op == "**" && c1 == 0 && c2 == 0) coef = 0;
+    else if (op == "**" && c1 == 0 && evalConstant(root->children[0], invariant, k)) coef = k * c2;
+    else if (op == "**" && c2 == 0 && evalConstant(root->children[1], invariant, k)) coef = c1 * k;
+    else if (op == "//" && c1 == 0 && c2 == 0 && evalConstant(root->children[1], invariant, k) && k != 0) coef = 0;
+    else return false;
+    return coef >= -VALUE_LIMIT && coef <= VALUE_LIMIT;
+}
+
+// a derived induction variable: a product of the basic variable (scaled, plus invariants)
+// and a loop-invariant factor, which moves by factor * coef * step whenever the basic one steps
+struct DerivedInduction {
+    Node* product = nullptr;        // <exp> -> <M> ** <exp>
+    Node* factor = nullptr;         // the loop-invariant operand
+    long long coef = 0;             // coefficient of the basic variable in the other operand
+    bool constantFactor = false;
+    long long factorValue = 0;
+};
+
+// outermost products in an expression that are derived induction variables of id
+static void findDerivedInductions(Node* root, const std::string& id, const std::set<std::string>& assigned,
+                                  const std::map<std::string, int>& invariant, std::vector<DerivedInduction>& found) {
+    if (!root || reducedProducts.count(root)) return;
+    if (root->kind == NodeKind::Exp && !root->tokens.empty() && root->tokens[0] == "**") {
+        long long c1 = 0, c2 = 0;
+        if (inductionCoefficient(root->children[0], id, assigned, invariant, c1) &&
+            inductionCoefficient(root->children[1], id, assigned, invariant, c2) && (c1 == 0) != (c2 == 0)) {
+            DerivedInduction derived;
+            derived.product = root;
+            derived.factor = root->children[c1 ? 1 : 0];
+            derived.coef = c1 ? c1 : c2;
+            derived.constantFactor = evalConstant(derived.factor, invariant, derived.factorValue);
+            found.push_back(derived);
+            return;
+        }
+    }
+    for (auto child : root->children) findDerivedInductions(child, id, assigned, invariant, found);
+}
+
+// reads of a variable in a subtree: operands, and the identifier a cond or loop tests
+static int countReads(Node* root, const std::string& id) {
+    if (!root) return 0;
+    int reads = 0;
+    if (root->kind == NodeKind::R && root->children.empty() && !root->tokens.empty() && root->tokens[0] == id) reads++;
+    if ((root->kind == NodeKind::Cond || root->kind == NodeKind::Loop) && root->tokens.size() > 1 && root->tokens[1] == id) {
+        reads++;
+    }
+    if (root->kind == NodeKind::Call) {
+        auto sub = subroutines.find(root->tokens[0]);
+        if (sub != subroutines.end()) reads += countReads(sub->second.def->children[0], id);
+    }
+    for (auto child : root->children) reads += countReads(child, id);
+    return reads;
+}
+
+// build mainStatements, mainStatementIndex and mainReferences
+static void indexMainStatements(Node* root) {
+    mainStatements.clear();
+    mainStatementIndex.clear();
+    mainReferences.clear();
+    for (auto child : root->children) {
+        if (child->kind == NodeKind::Block) collectStatements(child, mainStatements);
+    }
+    for (size_t i = 0; i < mainStatements.size(); ++i) {
+        mainStatementIndex[mainStatements[i]] = i;
+        std::set<std::string> names;
+        collectReferenced(mainStatements[i], names);
+        for (const auto& name : names) mainReferences[name].push_back(i);
+    }
+}
+
+// whether id is dead once a loop of the main block exits: every later path writes it before
+// reading it, or never reads it again. Loops anywhere else (nested, or in a subroutine) may be
+// re-entered by code that reads id, so they never count as dead
+static bool deadAfterLoop(Node* loop, const std::string& id) {
+    auto pos = mainStatementIndex.find(loop);
+    if (pos == mainStatementIndex.end()) return false;
+    auto refs = mainReferences.find(id);
+    if (refs == mainReferences.end()) return true;
+    // only later statements that mention id can decide
+    const std::vector<size_t>& later = refs->second;
+    for (auto it = std::upper_bound(later.begin(), later.end(), pos->second); it != later.end(); ++it) {
+        Node* stmt = mainStatements[*it];
+        if (stmt->kind == NodeKind::Read && stmt->tokens[0] == id) return true;
+        if (stmt->kind == NodeKind::Assign) {
+            if (countReads(stmt->children[0], id)) return false;
+            if (stmt->tokens[0] == id) return true;
+        } else if (countReads(stmt, id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void traversal_impl(Node* root, std::vector<Instr>& out);
+
+// stable probe name prefix for a cond/loop node: kind:line:ordinal-on-line
+static const std::string& probePrefix(Node* root) {
+    auto it = probePrefixes.find(root);
+    if (it != probePrefixes.end()) return it->second;
+    int line = root->line_numbers.empty() ? 0 : root->line_numbers[0];
+    std::string prefix = root->type + ":" + std::to_string(line) + ":" + std::to_string(probesOnLine[line]++);
+    return probePrefixes[root] = prefix;
+}
+
+// count one execution of the probe (clobbers ACC)
+static void emitProbe(Node* root, const char* arm, std::vector<Instr>& out) {
+    if (!options.instrument) return;
+    std::string name = probePrefix(root) + ":" + arm;
+    auto cell = probeCells.find(name);
+    if (cell == probeCells.end()) {
+        cell = probeCells.insert({name, "p" + std::to_string(probeOrder.size())}).first;
+        probeOrder.push_back(name);
+    }
+    emit(out, "LOAD", cell->second);
+    emit(out, "ADD", "1");
+    emit(out, "STORE", cell->second);
+}
+
+// profiled count for a probe, or -1 without a profile entry
+static long long profileCount(Node* root, const char* arm) {
+    if (options.profile.empty()) return -1;
+    auto it = options.profile.find(probePrefix(root) + ":" + arm);
+    return it == options.profile.end() ? -1 : it->second;
+}
+
+// cond/loop test: evaluate RHS <exp>, then leave identifier (LHS) - RHS in ACC
+static void emitComparison(Node* root, std::vector<Instr>& out) {
+    traversal_impl(root->children[1], out);
+    std::string rhsTemp = createTempVar();
+    emit(out, "STORE", rhsTemp);
+    emit(out, "LOAD", root->tokens[1]);
+    emit(out, "SUB", rhsTemp);
+}
+
+// branch to label when the relation holds (whenHolds) or fails, falling through otherwise
+static void emitRelationalBranch(const std::string& relTok, bool whenHolds, const std::string& label,
+                                 std::vector<Instr>& out) {
+    const RelationalLowering& lowering = lowerRelational(relTok);
+    for (const char* branch : whenHolds ? lowering.whenTrue : lowering.whenFalse) {
+        if (branch) emit(out, branch, label);
+    }
+}
+
+// first source line recorded anywhere in a subtree (print nodes carry none themselves)
+static int nodeLine(Node* root) {
+    if (!root) return 0;
+    if (!root->line_numbers.empty()) return root->line_numbers[0];
+    for (auto child : root->children) {
+        int line = nodeLine(child);
+        if (line) return line;
+    }
+    return 0;
+}
+
+// attribute instructions not yet claimed by a nested statement to this statement
+static void stampSource(Node* root, std::vector<Instr>& out, size_t first) {
+    int line = nodeLine(root);
+    for (size_t i = first; i < out.size(); ++i) {
+        if (out[i].kind.empty()) {
+            out[i].line = line;
+            out[i].kind = root->type;
+        }
+    }
+}
+
+// stamps everything a statement emitted once its traversal returns, on every exit path
+struct SourceStamp {
+    Node* root;
+    std::vector<Instr>& out;
+    size_t first;
+    ~SourceStamp() {
+        if (root) stampSource(root, out, first);
+    }
+};
+
+// scan identifier :
+static void genRead(Node* root, std::vector<Instr>& out) {
+    // read input into variable
+    std::string varName = root->tokens[0];
+    emit(out, "READ", varName);
+    knownValues.erase(varName);
+}
+
+// output <exp> :
+static void genPrint(Node* root, std::vector<Instr>& out) {
+    // continue to child to get expression value
+    traversal_impl(root->children[0], out);
+    // store expression result in temp variable
+    std::string tempVar = createTempVar();
+    emit(out, "STORE", tempVar);
+    // print the result
+    emit(out, "WRITE", tempVar);
+}
+
+// cond [ identifier <relational> <exp> ] <stat>
+static void genCond(Node* root, std::vector<Instr>& out) {
+    if (root->tokens.empty() || root->children.size() < 3) return;
+
+    // skip the stat with the inverted branch when the relation fails
+    emitComparison(root, out);
+    long long taken = profileCount(root, "then"), skipped = profileCount(root, "else");
+    bool coldThen = taken >= 0 && skipped > 0 && taken * COLD_ARM_RATIO <= skipped;
+
+    // the stat may be skipped, so anything it writes is unknown afterwards
+    std::map<std::string, int> entryValues = knownValues;
+    if (!coldThen) {
+        std::string skipLabel = createLabel();
+        emitRelationalBranch(relationalToken(root), false, skipLabel, out);
+        emitProbe(root, "then", out);
+        traversal_impl(root->children[2], out);
+        if (options.instrument) {
+            std::string endLabel = createLabel();
+            emit(out, "BR", endLabel);
+            emitLabel(out, skipLabel);
+            emitProbe(root, "else", out);
+            emitLabel(out, endLabel);
         } else {
-            std::string instr;
-            if (relTok == "?le") instr = "BRZNEG";   // ACC <= 0 -> true
-            else if (relTok == "?lt") instr = "BRNEG";   // ACC < 0 -> true
-            else if (relTok == "?ge") instr = "BRZPOS";  // ACC >= 0 -> true
-            else if (relTok == "?eq" || relTok == "==" || relTok == "= =") instr = "BRZERO"; // ACC == 0 -> true
-            else instr = "BRZERO"; // conservative default (equality)
+            emitLabel(out, skipLabel);
+        }
+    } else {
+        // rarely taken: branch out to the stat and fall through on the common path
+        std::string coldLabel = createLabel();
+        std::string endLabel = createLabel();
+        emitRelationalBranch(relationalToken(root), true, coldLabel, out);
+        emitProbe(root, "else", out);
+        emitLabel(out, endLabel);
+        std::vector<Instr> cold;
+        emitLabel(cold, coldLabel);
+        emitProbe(root, "then", cold);
+        traversal_impl(root->children[2], cold);
+        emit(cold, "BR", endLabel);
+        stampSource(root, cold, 0);
+        coldCode.insert(coldCode.end(), cold.begin(), cold.end());
+    }
+    knownValues = entryValues;
+    forgetAssigned(root->children[2]);
+}
+
+// what strength reduction did to one emission of a loop; when the counter was eliminated the
+// exit test becomes testCell - testBound, which has the sign of counter - bound
+struct InductionPlan {
+    Node* stepStmt = nullptr;
+    std::vector<Node*> reduced;     // products now read from running cells
+    std::string testCell;
+    long long testBound = 0;        // subtracted, unless testBoundCell is set
+    std::string testBoundCell;
+};
+
+// add a constant to ACC without a negative immediate
+static void emitAddConstant(std::vector<Instr>& out, long long value) {
+    if (value > 0) emit(out, "ADD", std::to_string(value));
+    else if (value < 0) emit(out, "SUB", std::to_string(-value));
+}
 
-            // branch-to-true pattern: if true -> jump to trueLabel, else jump past true block
-            out << instr << " " << trueLabel << "\n";
-            out << "BR " << endLabel << "\n";
-            out << trueLabel << ": NOOP\n";
-            traversal_impl(root->children[2], out);
-            out << endLabel << ": NOOP\n";
+// strength reduce a loop about to be emitted in rotated form: products of its counter evaluated
+// every iteration become running cells, set up here in the preheader and advanced by additions
+// where the counter steps; when nothing else reads the counter its step is dropped and test
+// the exit test rewritten to compare a running cell instead
+static void reduceInductionVariables(Node* root, std::vector<Instr>& out, InductionPlan& plan) {
+    if (!options.strengthReduce) return;
+    const std::string& id = root->tokens[1];
+    Node* body = root->children[2];
+    std::map<std::string, int> invariant = invariantValues(root);
+    long long step = 0;
+    Node* stepStmt = nullptr;
+    if (!basicInductionStep(root, invariant, step, stepStmt)) return;
+    plan.stepStmt = stepStmt;
+
+    // only products evaluated on every iteration are worth an addition per step
+    std::set<std::string> assigned;
+    collectAssigned(body, assigned);
+    std::vector<Node*> stmts;
+    collectStatements(body, stmts);
+    std::vector<DerivedInduction> derived;
+    for (auto stmt : stmts) {
+        if (stmt->kind == NodeKind::Assign || stmt->kind == NodeKind::Print) {
+            findDerivedInductions(stmt->children[0], id, assigned, invariant, derived);
+        } else if (stmt->kind == NodeKind::Cond || stmt->kind == NodeKind::Loop) {
+            findDerivedInductions(stmt->children[1], id, assigned, invariant, derived);
         }
     }
-    else if (root->type == "loop") {
-        // loop [ identifier <relational> <exp> ] <stat>
-        if (root->tokens.empty() || root->children.size() < 3) return;
 
-        std::string startLabel = createLabel();
-        std::string bodyLabel  = createLabel();
-        std::string endLabel   = createLabel();
+    // keep products whose per-step change fits a cell and actually moves
+    derived.erase(std::remove_if(derived.begin(), derived.end(), [&](const DerivedInduction& d) {
+        long long scale = d.coef * step, increment = scale * d.factorValue;
+        if (scale < -VALUE_LIMIT || scale > VALUE_LIMIT) return true;
+        return d.constantFactor && (increment == 0 || increment < -VALUE_LIMIT || increment > VALUE_LIMIT);
+    }), derived.end());
 
-        out << startLabel << ": NOOP\n";
+    // the counter can go when the loop reads it only in the test, its own step and reduced
+    // products, and nothing reads it after the loop
+    int ownReads = 1 + countReads(stepStmt->children[0], id);
+    for (const auto& d : derived) ownReads += countReads(d.product, id);
+    bool counterDead = !derived.empty() && countReads(root, id) == ownReads && deadAfterLoop(root, id);
+    long long trips = 0, bound = 0;
+    bool boundedTrips = counterDead && constantTripCount(root, MAX_ANALYZED_TRIPS, trips) &&
+                        evalConstant(root->children[1], invariant, bound);
 
-        // evaluate RHS <exp> -> leave result in ACC
-        traversal_impl(root->children[1], out);
-        // save RHS
-        std::string rhsTemp = createTempVar();
-        out << "STORE " << rhsTemp << "\n";
-
-        // load identifier (LHS) and compute LHS - RHS in ACC
-        std::string id = root->tokens[1];
-        out << "LOAD " << id << "\n";
-        out << "SUB " << rhsTemp << "\n";
-
-        // relational operator token in children[0]
-        std::string relTok;
-        if (!root->children[0]->tokens.empty()) relTok = root->children[0]->tokens[0];
-
-        if (relTok == ";") {
-            // NOT EQUAL: if ACC == 0 -> exit loop, else fall through to body
-            out << "BRZERO " << endLabel << "\n";
-            traversal_impl(root->children[2], out);
-            out << "BR " << startLabel << "\n";
-            out << endLabel << ": NOOP\n";
+    std::vector<InductionUpdate>& updates = inductionUpdates[stepStmt];
+    for (const auto& d : derived) {
+        long long scale = d.coef * step;
+        InductionUpdate update;
+        update.cell = createTempVar();
+        long long start = 0;
+        bool knownStart = evalConstant(d.product, knownValues, start);
+        if (knownStart) {
+            emit(out, "LOAD", std::to_string(std::max(start, 0LL)));
+            if (start < 0) emitAddConstant(out, start);
+        } else {
+            traversal_impl(d.product, out);
+        }
+        emit(out, "STORE", update.cell);
+        if (d.constantFactor) {
+            update.increment = scale * d.factorValue;
+        } else {
+            update.incrementCell = createTempVar();
+            traversal_impl(d.factor, out);
+            if (scale != 1 && scale != -1) emit(out, "MULT", std::to_string(std::llabs(scale)));
+            emit(out, "STORE", update.incrementCell);
+            if (scale < 0) {
+                emit(out, "LOAD", "0");
+                emit(out, "SUB", update.incrementCell);
+                emit(out, "STORE", update.incrementCell);
+            }
+        }
+        updates.push_back(update);
+        reducedProducts[d.product] = update.cell;
+        plan.reduced.push_back(d.product);
+
+        // the cell moves with the counter at a fixed positive rate, so it can carry the test,
+        // provided cell - bound cannot wrap anywhere between the first and the last test
+        long long rate = d.coef * d.factorValue;
+        if (!plan.testCell.empty() || !boundedTrips || !d.constantFactor || rate <= 0) continue;
+        long long first = rate * (knownValues[id] - bound), last = rate * (knownValues[id] + trips * step - bound);
+        if (std::llabs(first) > VALUE_LIMIT || std::llabs(last) > VALUE_LIMIT) continue;
+        plan.testCell = update.cell;
+        if (knownStart && std::llabs(start - first) <= VALUE_LIMIT) {
+            plan.testBound = start - first;
         } else {
-            std::string instr;
-            if (relTok == "?le") instr = "BRZNEG";   // ACC <= 0 -> enter body
-            else if (relTok == "?lt") instr = "BRNEG";   // ACC < 0 -> enter body
-            else if (relTok == "?ge") instr = "BRZPOS";  // ACC >= 0 -> enter body
-            else if (relTok == "?eq" || relTok == "==" || relTok == "= =") instr = "BRZERO"; // ACC == 0 -> enter body
-            else instr = "BRZERO";
-
-            out << instr << " " << bodyLabel << "\n";
-            out << "BR " << endLabel << "\n";
-            out << bodyLabel << ": NOOP\n";
-            traversal_impl(root->children[2], out);
-            out << "BR " << startLabel << "\n";
-            out << endLabel << ": NOOP\n";
-        }
-    }
-    else if (root->type == "assign") {
-        // set identifier = <exp> :
-        std::string varName = root->tokens[0];
+            plan.testBoundCell = createTempVar();
+            emit(out, "LOAD", update.cell);
+            emitAddConstant(out, -first);
+            emit(out, "STORE", plan.testBoundCell);
+        }
+    }
+    if (!plan.testCell.empty()) droppedSteps.insert(stepStmt);
+}
+
+// loop [ identifier <relational> <exp> ] <stat>
+static void genLoop(Node* root, std::vector<Instr>& out) {
+    if (root->tokens.empty() || root->children.size() < 3) return;
+
+    // unroll when the trip count is known: fully if it fits the budget, otherwise
+    // peel the remainder and repeat the body several times per test; the profile
+    // widens the budget for hot loops and withholds it from loops that never ran
+    Node* body = root->children[2];
+    auto emitBody = [&]() {
+        emitProbe(root, "body", out);
+        traversal_impl(body, out);
+    };
+    int budget = options.unrollBudget;
+    long long bodyCount = profileCount(root, "body");
+    if (bodyCount == 0) budget = 0;
+    else if (bodyCount >= HOT_LOOP_COUNT) budget *= HOT_LOOP_BUDGET_SCALE;
+
+    int copies = 1;
+    long long trips = 0;
+    int bodySize = std::max(1, estimateSize(body));
+    bool knownTrips = constantTripCount(root, MAX_ANALYZED_TRIPS, trips);
+    if (budget > 0 && knownTrips) {
+        if (trips * bodySize <= budget) {
+            for (long long i = 0; i < trips; ++i) emitBody();
+            emitProbe(root, "exit", out);
+            return;
+        }
+        long long factor = std::min<long long>(budget / bodySize, trips / 2);
+        if (factor >= 2) {
+            for (long long i = 0; i < trips % factor; ++i) emitBody();
+            copies = static_cast<int>(factor);
+        }
+    }
+    if (knownTrips) recordLoopTrips(nodeLine(root), trips / copies);
+
+    InductionPlan plan;
+    reduceInductionVariables(root, out, plan);
+
+    // values written by the body are unknown at the loop head and after the loop
+    forgetAssigned(body);
+    std::map<std::string, int> headValues = knownValues;
+
+    // rotated loop: enter at the test, which sits below the body, so every iteration
+    // takes a single conditional branch back to the body
+    std::string bodyLabel = createLabel();
+    std::string testLabel = createLabel();
+    emit(out, "BR", testLabel);
+    emitLabel(out, bodyLabel);
+    for (int i = 0; i < copies; ++i) emitBody();
+    emitLabel(out, testLabel);
+    if (plan.testCell.empty()) {
+        emitComparison(root, out);
+    } else {
+        emit(out, "LOAD", plan.testCell);
+        if (!plan.testBoundCell.empty()) emit(out, "SUB", plan.testBoundCell);
+        else emitAddConstant(out, -plan.testBound);
+    }
+    emitRelationalBranch(relationalToken(root), true, bodyLabel, out);
+    emitProbe(root, "exit", out);
+    knownValues = headValues;
+
+    // the running cells belong to this emission of the loop only
+    for (auto product : plan.reduced) reducedProducts.erase(product);
+    inductionUpdates.erase(plan.stepStmt);
+    droppedSteps.erase(plan.stepStmt);
+}
+
+// set identifier = <exp> :
+static void genAssign(Node* root, std::vector<Instr>& out) {
+    std::string varName = root->tokens[0];
+    if (droppedSteps.count(root)) {
+        // eliminated loop counter: only the running cells derived from it move
+        knownValues.erase(varName);
+    } else {
         // evaluate expression -> leave result in ACC
         traversal_impl(root->children[0], out);
         // store result into variable
-        out << "STORE " << varName << "\n";
+        emit(out, "STORE", varName);
+        long long value = 0;
+        if (evalConstant(root->children[0], knownValues, value)) knownValues[varName] = static_cast<int>(value);
+        else knownValues.erase(varName);
     }
-    else if (root->type == "exp") {
-        if (!root->tokens.empty() && root->tokens[0] == "**") {
-            // multiplication
-            // call right child
-            traversal_impl(root->children[1], out);
-            // store right child result in temp variable
-            std::string tempVar = createTempVar(); 
-            out << "STORE " << tempVar << "\n";
-            // call left child
-            traversal_impl(root->children[0], out);
-            // multiply with right child result
-            out << "MULT " << tempVar << "\n";
-        } 
-        else if (!root->tokens.empty() && root->tokens[0] == "//") {
-            // integer division
-            // call right child
-            traversal_impl(root->children[1], out);
-            // store right child result in temp variable
-            std::string tempVar = createTempVar(); 
-            out << "STORE " << tempVar << "\n";
-            // call left child
-            traversal_impl(root->children[0], out);
-            // divide by right child result
-            out << "DIV " << tempVar << "\n";
-        } 
-        else {
-            // single M child
-            traversal_impl(root->children[0], out);
+    // a loop counter stepped: advance the products strength reduced from it
+    auto updates = inductionUpdates.find(root);
+    if (updates == inductionUpdates.end()) return;
+    for (const auto& update : updates->second) {
+        emit(out, "LOAD", update.cell);
+        if (!update.incrementCell.empty()) emit(out, "ADD", update.incrementCell);
+        else emitAddConstant(out, update.increment);
+        emit(out, "STORE", update.cell);
+    }
+}
+
+// the expression a node computes once nodes with a single child and parentheses are looked
+// through; strength-reduced products stop the descent, since their cell replaces the code
+static Node* expressionBelow(Node* node) {
+    while (!reducedProducts.count(node) && node->children.size() == 1 &&
+           (node->kind == NodeKind::R || node->tokens.empty())) {
+        node = node->children[0];
+    }
+    return node;
+}
+
+// operands bound by matching a rewrite's shape
+struct RewriteMatch {
+    Node* leaves[4] = {};
+    Node* e = nullptr;
+};
+
+static bool matchShape(const Shape& shape, Node* node, RewriteMatch& match) {
+    node = expressionBelow(node);
+    bool reduced = reducedProducts.count(node) > 0;
+    if (shape.op.empty()) {
+        if (shape.operand == 'e') {
+            match.e = node;
+            return true;
+        }
+        if (reduced || node->kind != NodeKind::R || !node->children.empty()) return false;
+        match.leaves[shape.operand - 'a'] = node;
+        return true;
+    }
+    if (reduced || node->kind == NodeKind::R || node->tokens.empty() || node->tokens[0] != shape.op ||
+        node->children.size() != shape.children.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < shape.children.size(); ++i) {
+        if (!matchShape(shape.children[i], node->children[i], match)) return false;
+    }
+    return true;
+}
+
+// rules by the operator at the top of their shape
+static std::map<std::string, std::vector<const RewriteRule*>> rewritesByOp;
+
+// emit the matching rewrite that saves the most over the template for an operator node;
+// false (nothing emitted) if none matches
+static bool emitRewrite(Node* root, std::vector<Instr>& out) {
+    auto rules = rewritesByOp.find(root->tokens[0]);
+    if (rules == rewritesByOp.end()) return false;
+    const RewriteRule* best = nullptr;
+    RewriteMatch bestMatch;
+    int bestSaving = 0;
+    for (const RewriteRule* rule : rules->second) {
+        int saving = rule->templateLength - static_cast<int>(rule->code.size());
+        RewriteMatch match;
+        if (!matchShape(rule->shape, root, match)) continue;
+        if (match.e) saving++;
+        if (saving > bestSaving) {
+            best = rule;
+            bestMatch = match;
+            bestSaving = saving;
+        }
+    }
+    if (!best) return false;
+    std::string temps[2];
+    for (const auto& step : best->code) {
+        const std::string& arg = step.arg;
+        if (step.op == "EVAL") {
+            traversal_impl(bestMatch.e, out);
+        } else if (arg.size() == 1 && arg[0] >= 'a' && arg[0] <= 'd') {
+            emit(out, step.op, bestMatch.leaves[arg[0] - 'a']->tokens[0]);
+        } else if (arg == "t0" || arg == "t1") {
+            std::string& temp = temps[arg[1] - '0'];
+            if (temp.empty()) temp = createTempVar();
+            emit(out, step.op, temp);
+        } else {
+            emit(out, step.op, arg);
         }
+    }
+    return true;
+}
+
+// <exp> -> <M> ** <exp> | <M> // <exp> | <M>
+static void genExp(Node* root, std::vector<Instr>& out) {
+    // strength-reduced product: its running cell already holds the value
+    auto reduced = reducedProducts.find(root);
+    if (reduced != reducedProducts.end()) {
+        emit(out, "LOAD", reduced->second);
+        return;
+    }
+    if (!root->tokens.empty() && emitRewrite(root, out)) return;
+    if (!root->tokens.empty() && root->tokens[0] == "**") {
+        // multiplication
+        // call right child
+        traversal_impl(root->children[1], out);
+        // store right child result in temp variable
+        std::string tempVar = createTempVar(); 
+        emit(out, "STORE", tempVar);
+        // call left child
+        traversal_impl(root->children[0], out);
+        // multiply with right child result
+        emit(out, "MULT", tempVar);
+    } 
+    else if (!root->tokens.empty() && root->tokens[0] == "//") {
+        // integer division
+        // call right child
+        traversal_impl(root->children[1], out);
+        // store right child result in temp variable
+        std::string tempVar = createTempVar(); 
+        emit(out, "STORE", tempVar);
+        // call left child
+        traversal_impl(root->children[0], out);
+        // divide by right child result
+        emit(out, "DIV", tempVar);
+    } 
+    else {
+        // single M child
+        traversal_impl(root->children[0], out);
+    }
+}
+
+// <M> -> <N> + <M> | <N>
+static void genM(Node* root, std::vector<Instr>& out) {
+    if (!root->tokens.empty() && emitRewrite(root, out)) return;
+    if (!root->tokens.empty() && root->tokens[0] == "+") {
+        // addition
+        // call right child
+        traversal_impl(root->children[1], out);
+        // store right child result in temp variable
+        std::string tempVar = createTempVar(); 
+        emit(out, "STORE", tempVar);
+        // call left child
+        traversal_impl(root->children[0], out);
+        // add right child result
+        emit(out, "ADD", tempVar);
     } 
-    else if (root->type == "M") {
-        if (!root->tokens.empty() && root->tokens[0] == "+") {
-            // addition
-            // call right child
+    else {
+        // single N child
+        traversal_impl(root->children[0], out);
+    }
+}
+
+// <N> -> <R> - <N> | - <N> | <R>
+static void genN(Node* root, std::vector<Instr>& out) {
+    // <N> -> <R> - <N> | - <N> | <R>
+    if (!root->tokens.empty() && emitRewrite(root, out)) return;
+    if (!root->tokens.empty() && root->tokens[0] == "-") {
+        if (root->children.size() == 1) {
+            // unary minus: - <N>
+            traversal_impl(root->children[0], out);
+            std::string tempVar = createTempVar();
+            emit(out, "STORE", tempVar);
+            emit(out, "LOAD", "0");
+            emit(out, "SUB", tempVar);
+        } else if (root->children.size() >= 2) {
+            // binary subtraction
+            // evaluate right child
             traversal_impl(root->children[1], out);
             // store right child result in temp variable
-            std::string tempVar = createTempVar(); 
-            out << "STORE " << tempVar << "\n";
-            // call left child
-            traversal_impl(root->children[0], out);
-            // add right child result
-            out << "ADD " << tempVar << "\n";
-        } 
-        else {
-            // single N child
+            std::string tempVar = createTempVar();
+            emit(out, "STORE", tempVar);
+            // evaluate left child
             traversal_impl(root->children[0], out);
+            // subtract right child result
+            emit(out, "SUB", tempVar);
         }
-    } 
-    else if (root->type == "N") {
-        // <N> -> <R> - <N> | - <N> | <R>
-        if (!root->tokens.empty() && root->tokens[0] == "-") {
-            if (root->children.size() == 1) {
-                // unary minus: - <N>
-                traversal_impl(root->children[0], out);
-                std::string tempVar = createTempVar();
-                out << "STORE " << tempVar << "\n";
-                out << "LOAD 0\n";
-                out << "SUB " << tempVar << "\n";
-            } else if (root->children.size() >= 2) {
-                // binary subtraction
-                // evaluate right child
-                traversal_impl(root->children[1], out);
-                // store right child result in temp variable
-                std::string tempVar = createTempVar();
-                out << "STORE " << tempVar << "\n";
-                // evaluate left child
-                traversal_impl(root->children[0], out);
-                // subtract right child result
-                out << "SUB " << tempVar << "\n";
+    } else {
+        // single <R> child
+        if (!root->children.empty()) traversal_impl(root->children[0], out);
+    }
+}
+
+// <R> -> ( <exp> ) | identifier | integer
+static void genR(Node* root, std::vector<Instr>& out) {
+    if (root->children.size() == 1 && root->children[0]->kind == NodeKind::Exp) {
+        // case: exp
+        traversal_impl(root->children[0], out);
+    }
+    // TODO: may not need both cases becuase you print LOAD either way
+    else if (std::isalpha(static_cast<unsigned char>(root->tokens[0][0]))) {
+        // case: identifier
+        emit(out, "LOAD", root->tokens[0]);
+    }
+    else {
+        // case: integer
+        emit(out, "LOAD", root->tokens[0]);
+    }
+}
+
+// func identifier :
+static void genCall(Node* root, std::vector<Instr>& out) {
+    Subroutine& sub = subroutines.at(root->tokens[0]);
+    Node* body = sub.def->children[0];
+    if (shouldInline(sub)) {
+        traversal_impl(body, out);
+        return;
+    }
+    // record the call-site index for the return dispatch, then jump to the body
+    if (sub.entryLabel.empty()) sub.entryLabel = createLabel();
+    std::string returnLabel = createLabel();
+    emit(out, "LOAD", std::to_string(sub.returnLabels.size()));
+    emit(out, "STORE", "r" + std::to_string(sub.index));
+    emit(out, "BR", sub.entryLabel);
+    emitLabel(out, returnLabel);
+    sub.returnLabels.push_back(returnLabel);
+    forgetAssigned(root);
+}
+
+// bodies of subroutines called out of line; generating one may add calls to others
+static void generateSubroutines() {
+    bool pending = true;
+    while (pending) {
+        pending = false;
+        for (auto& entry : subroutines) {
+            Subroutine& sub = entry.second;
+            if (sub.generated || sub.returnLabels.empty()) continue;
+            sub.generated = pending = true;
+            // callers differ, so nothing is known on entry
+            std::map<std::string, int> callerValues = knownValues;
+            knownValues.clear();
+            emitLabel(sub.code, sub.entryLabel);
+            traversal_impl(sub.def->children[0], sub.code);
+            knownValues = callerValues;
+        }
+    }
+    // return dispatch, now that every call site is known: ACC = site index, count it down
+    for (auto& entry : subroutines) {
+        Subroutine& sub = entry.second;
+        if (!sub.generated) continue;
+        size_t first = sub.code.size();
+        const std::vector<std::string>& returns = sub.returnLabels;
+        if (returns.size() > 1) emit(sub.code, "LOAD", "r" + std::to_string(sub.index));
+        for (size_t i = 0; i + 1 < returns.size(); ++i) {
+            if (i > 0) emit(sub.code, "SUB", "1");
+            emit(sub.code, "BRZERO", returns[i]);
+        }
+        emit(sub.code, "BR", returns.back());
+        stampSource(sub.def, sub.code, first);
+    }
+}
+
+// generate code for a subtree, dispatching on its node kind
+static void traversal_impl(Node* root, std::vector<Instr>& out) {
+    if (!root) return;
+    SourceStamp stamp = {isStatement(root->kind) ? root : nullptr, out, out.size()};
+    switch (root->kind) {
+        case NodeKind::Read:   genRead(root, out); break;
+        case NodeKind::Print:  genPrint(root, out); break;
+        case NodeKind::Cond:   genCond(root, out); break;
+        case NodeKind::Loop:   genLoop(root, out); break;
+        case NodeKind::Assign: genAssign(root, out); break;
+        case NodeKind::Exp:    genExp(root, out); break;
+        case NodeKind::M:      genM(root, out); break;
+        case NodeKind::N:      genN(root, out); break;
+        case NodeKind::R:      genR(root, out); break;
+        case NodeKind::Call:   genCall(root, out); break;
+        case NodeKind::Func:   break; // bodies are generated where they are called
+        default:
+            for (auto child : root->children) traversal_impl(child, out);
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// partial evaluation (--partial-eval): the main block runs here, at compile time, for as
+// long as its operands are known and the step budget lasts. only statements depending on
+// scan input (or left when the budget runs out) become code; values computed before them
+// are placed in the cells' initial values, or stored by the code when a cell is in use
+// ---------------------------------------------------------------------------
+
+struct PartialEvaluator {
+    std::map<std::string, int> values;  // compile-time value of every variable still known
+    std::map<std::string, int> memory;  // what each cell is known to hold when the code runs
+    std::set<std::string> fixed;        // cells whose initial value is decided or that code touches
+    long long steps = 0;
+    bool exhausted = false;
+    bool trapped = false;               // a statement left as code certainly divides by zero
+    int residual = 0;                   // statements turned into code
+};
+static PartialEvaluator pe;
+
+// make the cell of a known variable hold its value before code reads or conditionally writes it
+static void peMaterialize(const std::string& name, std::vector<Instr>& out) {
+    int value = pe.values[name];
+    auto held = pe.memory.find(name);
+    if (held != pe.memory.end() && held->second == value) return;
+    if (!pe.fixed.count(name)) {
+        // nothing has used the cell yet, so it can simply start out holding the value
+        initialValues[name] = value;
+        pe.fixed.insert(name);
+    } else {
+        emit(out, "LOAD", std::to_string(std::max(value, 0)));
+        emitAddConstant(out, std::min(value, 0));
+        emit(out, "STORE", name);
+    }
+    pe.memory[name] = value;
+}
+
+// generate a statement that cannot run at compile time
+static void peResidual(Node* stmt, std::vector<Instr>& out) {
+    pe.residual++;
+    std::set<std::string> referenced, assigned;
+    collectReferenced(stmt, referenced);
+    collectAssigned(stmt, assigned);
+    for (const auto& name : referenced) {
+        if (pe.values.count(name)) peMaterialize(name, out);
+    }
+    knownValues = pe.memory;
+    traversal_impl(stmt, out);
+    // whatever the code may write is known afterwards only if the generator still knows it
+    for (const auto& name : assigned) {
+        auto known = knownValues.find(name);
+        if (known != knownValues.end()) pe.values[name] = known->second;
+        else pe.values.erase(name);
+    }
+    pe.memory = knownValues;
+    pe.fixed.insert(referenced.begin(), referenced.end());
+}
+
+// evaluate a cond/loop test at compile time; false if it depends on unknown values
+static bool peTest(Node* root, bool& holds) {
+    auto lhs = pe.values.find(root->tokens[1]);
+    long long rhs = 0;
+    if (lhs == pe.values.end() || !evalConstant(root->children[1], pe.values, rhs)) return false;
+    long long diff = lhs->second - rhs;
+    if (diff < -VALUE_LIMIT || diff > VALUE_LIMIT) return false;
+    holds = relationHolds(relationalToken(root), diff);
+    return true;
+}
+
+// whether a loop can run at compile time from here: everything it mentions is known and
+// it never reads input
+static bool peStaticLoop(Node* root) {
+    std::set<std::string> referenced;
+    collectReferenced(root, referenced);
+    for (const auto& name : referenced) {
+        if (!pe.values.count(name)) return false;
+    }
+    std::function<bool(Node*)> readsInput = [&](Node* n) {
+        if (!n) return false;
+        if (n->kind == NodeKind::Read) return true;
+        if (n->kind == NodeKind::Call && readsInput(subroutines.at(n->tokens[0]).def->children[0])) return true;
+        for (auto child : n->children) {
+            if (readsInput(child)) return true;
+        }
+        return false;
+    };
+    return !readsInput(root);
+}
+
+// whether an expression divides by a divisor known to be zero here, so that its code
+// always traps
+static bool peDividesByZero(Node* root) {
+    if (!root) return false;
+    long long divisor = 0;
+    if (!root->tokens.empty() && root->tokens[0] == "//" && root->children.size() == 2 &&
+        evalConstant(root->children[1], pe.values, divisor) && divisor == 0) {
+        return true;
+    }
+    for (auto child : root->children) {
+        if (peDividesByZero(child)) return true;
+    }
+    return false;
+}
+
+static void peStatement(Node* root, std::vector<Instr>& out) {
+    // nothing after a certain trap runs, so nothing after it is evaluated or generated
+    if (!root || pe.trapped) return;
+    switch (root->kind) {
+        case NodeKind::Block:
+            if (root->children.size() > 1) peStatement(root->children[1], out);
+            return;
+        case NodeKind::Stats:
+        case NodeKind::MStat:
+        case NodeKind::Stat:
+            for (auto child : root->children) peStatement(child, out);
+            return;
+        case NodeKind::Func:
+            return;
+        default:
+            break;
+    }
+    Node* expression = nullptr;
+    if (root->kind == NodeKind::Assign || root->kind == NodeKind::Print) expression = root->children[0];
+    else if (root->kind == NodeKind::Cond || root->kind == NodeKind::Loop) expression = root->children[1];
+    bool traps = peDividesByZero(expression);
+    if (pe.exhausted || traps) {
+        peResidual(root, out);
+        pe.trapped = traps;
+        return;
+    }
+    if (++pe.steps >= options.peBudget) pe.exhausted = true;
+
+    long long value = 0;
+    bool holds = false;
+    switch (root->kind) {
+        case NodeKind::Print:
+            if (!evalConstant(root->children[0], pe.values, value)) {
+                peResidual(root, out);
+                break;
             }
-        } else {
-            // single <R> child
-            if (!root->children.empty()) traversal_impl(root->children[0], out);
+            if (value >= 0) {
+                emit(out, "WRITE", std::to_string(value));
+            } else {
+                std::string& cell = constantCells[static_cast<int>(value)];
+                if (cell.empty()) cell = "c" + std::to_string(constantCells.size() - 1);
+                emit(out, "WRITE", cell);
+            }
+            stampSource(root, out, out.size() - 1);
+            break;
+        case NodeKind::Assign:
+            // a zero divisor or a value out of range is left for the code to run into
+            if (evalConstant(root->children[0], pe.values, value)) pe.values[root->tokens[0]] = static_cast<int>(value);
+            else peResidual(root, out);
+            break;
+        case NodeKind::Cond:
+            if (!peTest(root, holds)) peResidual(root, out);
+            else if (holds) peStatement(root->children[2], out);
+            break;
+        case NodeKind::Loop: {
+            if (!peStaticLoop(root)) {
+                peResidual(root, out);
+                break;
+            }
+            // iterate while the test stays known; once an iteration had to emit code (or the
+            // budget ran out) the rest of the loop is emitted as a loop rather than unrolled
+            while (true) {
+                if (!peTest(root, holds)) {
+                    peResidual(root, out);
+                    break;
+                }
+                if (!holds) break;
+                int residual = pe.residual;
+                peStatement(root->children[2], out);
+                if (pe.trapped) break;
+                if (pe.residual != residual || pe.exhausted) {
+                    if (peTest(root, holds) && !holds) break;
+                    peResidual(root, out);
+                    break;
+                }
+                if (++pe.steps >= options.peBudget) pe.exhausted = true;
+            }
+            break;
         }
-    } 
-    else if (root->type == "R") {
-        if (root->children.size() == 1 && root->children[0]->type == "exp") {
-            // case: exp
-            traversal_impl(root->children[0], out);
+        case NodeKind::Call:
+            peStatement(subroutines.at(root->tokens[0]).def->children[0], out);
+            break;
+        default:
+            peResidual(root, out);
+            break;
+    }
+}
+
+// partially evaluate the main block into out, starting from the declared initial values
+static void partialEvaluate(Node* root, std::vector<Instr>& out, CodegenStats& counts) {
+    pe = PartialEvaluator();
+    pe.values = knownValues;
+    pe.memory = knownValues;
+    for (auto child : root->children) {
+        if (child->kind == NodeKind::Block) peStatement(child, out);
+    }
+    knownValues = pe.memory;
+    counts.peSteps = pe.steps;
+    counts.peResidual = pe.residual;
+    counts.peExhausted = pe.exhausted;
+}
+
+// ---------------------------------------------------------------------------
+// parallel code generation: the main block's statements are split into chunks generated
+// on a thread pool, each numbering its own temps and labels from 0 and starting from the
+// known values the serial traversal would have at that point; chunks are then renumbered
+// and joined in source order, giving exactly the serial output
+// ---------------------------------------------------------------------------
+
+// smallest estimated program worth splitting, and chunks handed out per thread
+static const int PARALLEL_MIN_SIZE = 4096;
+static const int CHUNKS_PER_THREAD = 8;
+
+// effect of generating a subtree on knownValues, without generating it. mirrors the gen
+// functions; a wrong guess is caught when chunks are joined and only costs regeneration
+static void predictValues(Node* root) {
+    if (!root) return;
+    switch (root->kind) {
+        case NodeKind::Read:
+            knownValues.erase(root->tokens[0]);
+            break;
+        case NodeKind::Assign: {
+            long long value = 0;
+            if (evalConstant(root->children[0], knownValues, value)) knownValues[root->tokens[0]] = static_cast<int>(value);
+            else knownValues.erase(root->tokens[0]);
+            break;
         }
-        // TODO: may not need both cases becuase you print LOAD either way
-        else if (std::isalpha(static_cast<unsigned char>(root->tokens[0][0]))) {
-            // case: identifier
-            out << "LOAD " << root->tokens[0] << "\n";
+        case NodeKind::Cond:
+            if (root->children.size() >= 3) forgetAssigned(root->children[2]);
+            break;
+        case NodeKind::Loop: {
+            if (root->tokens.empty() || root->children.size() < 3) break;
+            Node* body = root->children[2];
+            long long trips = 0;
+            int bodySize = std::max(1, estimateSize(body));
+            if (options.unrollBudget > 0 && constantTripCount(root, MAX_ANALYZED_TRIPS, trips) &&
+                trips * bodySize <= options.unrollBudget) {
+                for (long long i = 0; i < trips; ++i) predictValues(body);
+            } else {
+                forgetAssigned(body);
+            }
+            break;
         }
-        else {
-            // case: integer
-            out << "LOAD " << root->tokens[0] << "\n";
+        case NodeKind::Call: {
+            Subroutine& sub = subroutines.at(root->tokens[0]);
+            if (shouldInline(sub)) predictValues(sub.def->children[0]);
+            else forgetAssigned(root);
+            break;
         }
+        case NodeKind::Print:
+        case NodeKind::Func:
+            break;
+        default:
+            for (auto child : root->children) predictValues(child);
+            break;
     }
-    else {
-        for (auto child : root->children) {
-            traversal_impl(child, out);
+}
+
+// a run of consecutive main-block statements generated by one task
+struct CodeChunk {
+    size_t begin = 0, end = 0;              // statement range
+    std::map<std::string, int> entryValues; // predicted, or the previous chunk's exit on regeneration
+    std::map<std::string, int> exitValues;
+    std::vector<Instr> code;
+    int temps = 0, labels = 0;
+    std::map<int, long long> loopTrips;
+};
+
+static void generateChunk(const std::vector<Node*>& stmts, CodeChunk& chunk) {
+    tempVarCounter = 0;
+    labelCounter = 0;
+    knownValues = chunk.entryValues;
+    reducedProducts.clear();
+    inductionUpdates.clear();
+    droppedSteps.clear();
+    loopTrips.clear();
+    chunk.code.clear();
+    for (size_t i = chunk.begin; i < chunk.end; ++i) traversal_impl(stmts[i], chunk.code);
+    chunk.temps = tempVarCounter;
+    chunk.labels = labelCounter;
+    chunk.exitValues = knownValues;
+    chunk.loopTrips = loopTrips;
+}
+
+// shift a chunk-local t<N> or L<N> to its place in the whole program
+static void renumber(std::string& name, int tempOffset, int labelOffset) {
+    if (name.size() < 2 || (name[0] != 't' && name[0] != 'L')) return;
+    for (size_t i = 1; i < name.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i]))) return;
+    }
+    int offset = name[0] == 't' ? tempOffset : labelOffset;
+    if (offset) name = name[0] + std::to_string(std::stoi(name.substr(1)) + offset);
+}
+
+// generate the program's main block on options.codegenThreads threads; false (nothing
+// generated) when it is too small, or uses state that depends on generation order:
+// instrumentation, a profile, or subroutines called out of line
+static bool generateParallel(Node* root, std::vector<Instr>& out, CodegenStats& counts) {
+    if (options.codegenThreads == 1 || options.instrument || !options.profile.empty()) return false;
+    for (auto& entry : subroutines) {
+        if (entry.second.callSites > 0 && !shouldInline(entry.second)) return false;
+    }
+    Node* mainBlock = nullptr;
+    for (auto child : root->children) {
+        if (child->kind == NodeKind::Block) mainBlock = child;
+    }
+    std::vector<Node*> stmts;
+    collectStatements(mainBlock, stmts);
+    std::vector<int> sizes;
+    long long total = 0;
+    for (auto stmt : stmts) {
+        sizes.push_back(estimateSize(stmt));
+        total += sizes.back();
+    }
+    if (stmts.size() < 2 || total < PARALLEL_MIN_SIZE) return false;
+
+    ThreadPool pool(options.codegenThreads < 0 ? 0 : options.codegenThreads);
+    if (pool.size() == 1) return false;
+
+    // cut into chunks of about equal size, predicting the known values at each cut
+    std::vector<CodeChunk> chunks;
+    long long target = std::max<long long>(1, total / (pool.size() * CHUNKS_PER_THREAD));
+    long long filled = 0;
+    for (size_t i = 0; i < stmts.size(); ++i) {
+        if (chunks.empty() || filled >= target) {
+            if (!chunks.empty()) chunks.back().end = i;
+            chunks.push_back(CodeChunk());
+            chunks.back().begin = i;
+            chunks.back().entryValues = knownValues;
+            filled = 0;
+        }
+        predictValues(stmts[i]);
+        filled += sizes[i];
+    }
+    chunks.back().end = stmts.size();
+
+    pool.parallelFor(chunks.size(), [&](size_t c) { generateChunk(stmts, chunks[c]); });
+
+    // a chunk that started from the wrong values is generated again from the right ones
+    for (size_t c = 1; c < chunks.size(); ++c) {
+        if (chunks[c].entryValues == chunks[c - 1].exitValues) continue;
+        chunks[c].entryValues = chunks[c - 1].exitValues;
+        generateChunk(stmts, chunks[c]);
+        counts.chunksRegenerated++;
+    }
+
+    // numbering continues where the serial traversal would be
+    std::vector<int> tempOffsets, labelOffsets;
+    int temps = 0, labels = 0;
+    size_t instructions = out.size();
+    for (const auto& chunk : chunks) {
+        tempOffsets.push_back(temps);
+        labelOffsets.push_back(labels);
+        temps += chunk.temps;
+        labels += chunk.labels;
+        instructions += chunk.code.size();
+    }
+    pool.parallelFor(chunks.size(), [&](size_t c) {
+        for (auto& instr : chunks[c].code) {
+            renumber(instr.label, tempOffsets[c], labelOffsets[c]);
+            renumber(instr.arg, tempOffsets[c], labelOffsets[c]);
+        }
+    });
+    out.reserve(instructions);
+    for (const auto& chunk : chunks) out.insert(out.end(), chunk.code.begin(), chunk.code.end());
+
+    tempVarCounter = temps;
+    labelCounter = labels;
+    knownValues = chunks.back().exitValues;
+    loopTrips.clear();
+    for (const auto& chunk : chunks) {
+        for (const auto& entry : chunk.loopTrips) recordLoopTrips(entry.first, entry.second);
+    }
+    counts.chunks = static_cast<int>(chunks.size());
+    return true;
+}
+
+// generate and optimize code for a checked parse tree
+AsmProgram generateProgram(Node* root, STATSEM& statsem, const CodegenOptions& opts, CodegenStats* stats) {
+    options = opts;
+    tempVarCounter = 0;
+    labelCounter = 0;
+    // every variable starts out holding its declared initial value
+    knownValues.clear();
+    for (const auto& entry : statsem.getVarTable()) knownValues[entry.first] = entry.second.initValue;
+
+    probeCells.clear();
+    probeOrder.clear();
+    loopTrips.clear();
+    probePrefixes.clear();
+    probesOnLine.clear();
+    coldCode.clear();
+    initialValues.clear();
+    constantCells.clear();
+    reducedProducts.clear();
+    inductionUpdates.clear();
+    droppedSteps.clear();
+    rewritesByOp.clear();
+    for (const auto& rule : options.rewrites) rewritesByOp[rule.shape.op].push_back(&rule);
+
+    // subroutine definitions and how often the source calls each one
+    subroutines.clear();
+    // numbered in definition order; a call can create the entry before its definition
+    int definitions = 0;
+    std::function<void(Node*)> countCalls = [&](Node* n) {
+        if (!n) return;
+        if (n->kind == NodeKind::Func) {
+            Subroutine& sub = subroutines[n->tokens[0]];
+            sub.def = n;
+            sub.index = definitions++;
         }
+        if (n->kind == NodeKind::Call) subroutines[n->tokens[0]].callSites++;
+        for (auto child : n->children) countCalls(child);
+    };
+    countCalls(root);
+    // after the subroutines, since a call references what its body does
+    if (options.strengthReduce) indexMainStatements(root);
+
+    AsmProgram program;
+    CodegenStats counts;
+    {
+        PhaseScope phase("codegen");
+        if (options.partialEval && !options.instrument) partialEvaluate(root, program.code, counts);
+        else if (!generateParallel(root, program.code, counts)) traversal_impl(root, program.code);
+        generateSubroutines();
+        for (const auto& probe : probeOrder) emit(program.code, "WRITE", probeCells[probe]);
+
+        // STOP has to stay last (storage follows it), so jump over out-of-line code
+        std::vector<Instr> outOfLine;
+        for (const auto& entry : subroutines) {
+            outOfLine.insert(outOfLine.end(), entry.second.code.begin(), entry.second.code.end());
+        }
+        outOfLine.insert(outOfLine.end(), coldCode.begin(), coldCode.end());
+        if (!outOfLine.empty()) {
+            std::string stopLabel = createLabel();
+            emit(program.code, "BR", stopLabel);
+            program.code.insert(program.code.end(), outOfLine.begin(), outOfLine.end());
+            emitLabel(program.code, stopLabel);
+        }
+        emit(program.code, "STOP");
+        allocateStorage(statsem, program);
+    }
+    counts.probes = probeOrder;
+    counts.loopTrips = loopTrips;
+    counts.temps = tempVarCounter;
+    counts.labels = labelCounter;
+    counts.cellsAllocated = static_cast<int>(program.data.size());
+    counts.instructionsEmitted = static_cast<int>(program.code.size());
+    recordCount("temps", counts.temps);
+    recordCount("labels", counts.labels);
+    recordCount("instructions emitted", counts.instructionsEmitted);
+    if (options.partialEval) {
+        recordCount("partial evaluation steps", counts.peSteps);
+        recordCount("statements left as code", counts.peResidual);
     }
+    if (counts.chunks) {
+        recordCount("codegen chunks", counts.chunks);
+        recordCount("codegen chunks regenerated", counts.chunksRegenerated);
+    }
+
+    {
+        PhaseScope phase("optimize");
+        counts.passes = runPasses(program, options.passes);
+    }
+    recordCount("instructions final", static_cast<long long>(program.code.size()));
+    if (options.printStats && options.partialEval) {
+        std::cerr << "partial evaluation: " << counts.peSteps << " steps, " << counts.peResidual
+                  << " statements left as code" << (counts.peExhausted ? " (budget exhausted)" : "") << std::endl;
+    }
+    if (options.printStats) printPassResults(counts.passes, std::cerr);
+    if (stats) *stats = counts;
+    return program;
 }
 
 // main traversal function
-void traversal(Node* root, std::ofstream& out, STATSEM& statsem) {
-    traversal_impl(root, out);
-    out << "STOP" << std::endl;
-    allocateStorage(statsem, out);
-}
\ No newline at end of file
+void traversal(Node* root, std::ofstream& out, STATSEM& statsem, const CodegenOptions& opts) {
+    writeAsm(generateProgram(root, statsem, opts), out);
+}
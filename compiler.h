@@ -3,10 +3,74 @@
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <string>
+#include <vector>
 #include "node.h"
 #include "token.h"
 #include "staticSemantics.h"
+#include "instr.h"
+#include "passManager.h"
+#include "rewrites.h"
 
-void traversal(Node* root, std::ofstream& out, STATSEM& statsem);
+// code generation tunables
+struct CodegenOptions {
+    // largest number of instructions a single loop may expand to when unrolled (0 disables unrolling)
+    int unrollBudget = 64;
+    // extra instructions inlining a subroutine at all its calls may cost over keeping one
+    // shared copy (negative never inlines)
+    int inlineBudget = 16;
+    // replace multiplications by a loop counter with running additions, and drop the counter
+    // when a derived value can carry the exit test
+    bool strengthReduce = true;
+    // run the main block at compile time as far as it does not depend on input, emitting
+    // only the rest (see partialEvaluate); peBudget bounds the statements and loop tests run
+    bool partialEval = false;
+    long long peBudget = 1000000;
+    // threads generating the main block's statements (0 one per core, 1 serial); the
+    // output is the same whatever the count
+    int codegenThreads = 1;
+    // passes run over the generated code, in order (see passManager.h); -O2 by default
+    std::vector<std::string> passes = pipelineForLevel(2);
+    // report what each pass did on stderr
+    bool printStats = false;
+    // count executions of every cond arm, loop body and loop exit in extra cells,
+    // written out (in CodegenStats::probes order) just before STOP
+    bool instrument = false;
+    // counts from an instrumented run, keyed by probe name; steers cond layout and unrolling
+    std::map<std::string, long long> profile;
+    // shorter code for small expression shapes (rewrites.h), used in place of the
+    // spill-right template wherever one matches
+    std::vector<RewriteRule> rewrites;
+};
+
+// what code generation produced and what the optimizer took away
+struct CodegenStats {
+    int temps = 0;              // temporaries allocated during traversal
+    int labels = 0;             // labels allocated during traversal
+    int cellsAllocated = 0;     // data cells from allocateStorage (variables and temps)
+    int instructionsEmitted = 0;
+    int chunks = 0;             // parallel codegen: statement chunks generated (0 if serial)
+    int chunksRegenerated = 0;  // chunks whose predicted entry values were wrong
+    long long peSteps = 0;      // partial evaluation: statements and loop tests run at compile time
+    int peResidual = 0;         // statements emitted as code instead
+    bool peExhausted = false;   // the step budget ran out
+    std::vector<PassResult> passes;     // time and changes of each pass run
+    std::vector<std::string> probes;    // instrumentation probe names, in output order
+    std::map<int, long long> loopTrips; // proven iterations per entry of loops kept as loops, by
+                                        // source line (-1 where they differ; see costModel.h)
+};
+
+// generate and optimize code for a checked parse tree; stats, if given, is filled in
+AsmProgram generateProgram(Node* root, STATSEM& statsem, const CodegenOptions& opts = CodegenOptions(),
+                           CodegenStats* stats = nullptr);
+
+// write a program in the target's text format
+void writeAsm(const AsmProgram& program, std::ostream& out);
+
+// write the .map sidecar: which source line and statement kind produced each instruction range
+void writeLineMap(const AsmProgram& program, std::ostream& out);
+
+void traversal(Node* root, std::ofstream& out, STATSEM& statsem, const CodegenOptions& opts = CodegenOptions());
 
 #endif 
\ No newline at end of file
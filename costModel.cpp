@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "costModel.h"
+
+// lines shown again, ranked by cost, after the table
+static const size_t HOTTEST_LINES = 10;
+// rounds of flow propagation for edges that lead backwards without being a loop (calls
+// to a subroutine placed earlier, out-of-line cond arms jumping back)
+static const int MAX_FLOW_ROUNDS = 32;
+
+// rough relative costs per opcode. the interpreter pays a dispatch for everything, so
+// only division and I/O stand out; native code makes division and the read/write
+// syscalls far more expensive than the rest
+int opcodeCost(const std::string& target, const std::string& op) {
+    static const std::map<std::string, int> vm = {
+        {"LOAD", 1}, {"STORE", 1}, {"ADD", 1}, {"SUB", 1}, {"MULT", 2}, {"DIV", 6},
+        {"READ", 20}, {"WRITE", 20}, {"NOOP", 1}, {"STOP", 0},
+    };
+    static const std::map<std::string, int> x86 = {
+        {"LOAD", 1}, {"STORE", 1}, {"ADD", 1}, {"SUB", 1}, {"MULT", 3}, {"DIV", 25},
+        {"READ", 200}, {"WRITE", 150}, {"NOOP", 0}, {"STOP", 0},
+    };
+    const std::map<std::string, int>& table = target == "x86_64" ? x86 : vm;
+    auto cost = table.find(op);
+    if (cost != table.end()) return cost->second;
+    if (op.compare(0, 2, "BR") == 0) return op == "BR" || target != "x86_64" ? 1 : 2;
+    return 1;
+}
+
+// source line of a statement: its first token's, or the first one below it
+static int statementLine(Node* root) {
+    if (!root) return 0;
+    if (!root->line_numbers.empty()) return root->line_numbers[0];
+    for (auto child : root->children) {
+        int line = statementLine(child);
+        if (line) return line;
+    }
+    return 0;
+}
+
+// loop statements around each statement's line; subroutine bodies count from their own
+// definition, since where they are called from varies
+static void loopDepths(Node* root, int depth, std::map<int, int>& depths) {
+    if (!root) return;
+    if (root->kind == NodeKind::Func) depth = 0;
+    if (isStatement(root->kind)) {
+        int& known = depths[statementLine(root)];
+        known = std::max(known, depth);
+    }
+    if (root->kind == NodeKind::Loop) depth++;
+    for (auto child : root->children) loopDepths(child, depth, depths);
+}
+
+// a loop in the generated code: the instructions from the target of a loop statement's
+// backward branch to that branch
+struct LoopRange {
+    size_t head, end;
+    double runs;                // iterations per entry
+};
+
+// estimated executions of every instruction, for one entry into the program
+static std::vector<double> estimateExecutions(const std::vector<Instr>& code,
+                                              const std::map<int, long long>& loopTrips) {
+    std::map<std::string, size_t> labels;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].label.empty()) labels[code[i].label] = i;
+    }
+    std::vector<long long> targets(code.size(), -1);
+    std::vector<LoopRange> loops;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].op.compare(0, 2, "BR") != 0) continue;
+        auto found = labels.find(code[i].arg);
+        if (found == labels.end()) continue;
+        targets[i] = static_cast<long long>(found->second);
+        if (code[i].kind != "loop" || found->second > i) continue;
+        auto trips = loopTrips.find(code[i].line);
+        loops.push_back({found->second, i, trips != loopTrips.end() && trips->second >= 0
+                                               ? static_cast<double>(trips->second) : ASSUMED_LOOP_TRIPS});
+    }
+
+    // jump threading can land an outer loop's back edge on an inner loop's test, so the
+    // ranges overlap without nesting; grow each range over the ranges ending inside it
+    std::sort(loops.begin(), loops.end(), [](const LoopRange& a, const LoopRange& b) { return a.end < b.end; });
+    for (size_t k = 0; k < loops.size(); ++k) {
+        for (size_t j = k; j-- > 0 && loops[j].end >= loops[k].head;) loops[k].head = std::min(loops[k].head, loops[j].head);
+    }
+    // outermost first where ranges start together
+    std::sort(loops.begin(), loops.end(), [](const LoopRange& a, const LoopRange& b) {
+        return a.head != b.head ? a.head < b.head : a.end > b.end;
+    });
+
+    std::vector<double> runs(code.size()), back(code.size());
+    for (int round = 0; round < MAX_FLOW_ROUNDS; ++round) {
+        std::vector<double> forward(code.size()), nextBack(code.size());
+        struct ActiveLoop { size_t end; double entries; };
+        std::vector<ActiveLoop> active;
+        size_t nextLoop = 0;
+        double flow = 1;
+        for (size_t i = 0; i < code.size(); ++i) {
+            double in = flow + forward[i] + back[i];
+            for (; nextLoop < loops.size() && loops[nextLoop].head == i; ++nextLoop) {
+                // everything entering the range (a rotated loop enters at its test) enters the loop
+                for (size_t j = i + 1; j <= loops[nextLoop].end; ++j) {
+                    in += forward[j];
+                    forward[j] = 0;
+                }
+                active.push_back({loops[nextLoop].end, in});
+                in *= loops[nextLoop].runs;
+            }
+            runs[i] = in;
+
+            const Instr& instr = code[i];
+            long long to = targets[i];
+            flow = in;
+            if (instr.op == "STOP") {
+                flow = 0;
+            } else if (instr.op.compare(0, 2, "BR") != 0 || to < 0) {
+                // falls through
+            } else if (!active.empty() && active.back().end == i) {
+                // back edge: leaves once per entry
+                flow = instr.op != "BR" ? active.back().entries : 0;
+            } else if (instr.kind == "func") {
+                // return dispatch, one branch per call site left in the chain, each
+                // as likely; the call site already continued
+                int sites = 0;
+                for (size_t j = i; j < code.size() && code[j].kind == "func" && code[j].line == instr.line; ++j) {
+                    if (code[j].op.compare(0, 2, "BR") == 0) sites++;
+                }
+                flow = instr.op != "BR" ? in - in / sites : 0;
+            } else {
+                // a call runs the body, then continues after it; a conditional branch
+                // is taken half the time
+                bool call = instr.kind == "call" && instr.op == "BR";
+                double taken = instr.op != "BR" ? in / 2 : in;
+                (static_cast<size_t>(to) > i ? forward : nextBack)[to] += taken;
+                if (!call) flow = in - taken;
+            }
+            while (!active.empty() && active.back().end <= i) active.pop_back();
+        }
+        if (nextBack == back) break;
+        back.swap(nextBack);
+    }
+    return runs;
+}
+
+CostReport estimateCost(const std::vector<Instr>& code, Node* root, const std::map<int, long long>& loopTrips,
+                        const std::string& target) {
+    std::vector<double> runs = estimateExecutions(code, loopTrips);
+    std::map<int, int> depths;
+    loopDepths(root, 0, depths);
+
+    CostReport report;
+    report.target = target;
+    std::map<int, LineCost> lines;
+    std::map<int, std::set<std::string>> kinds;
+    for (size_t i = 0; i < code.size(); ++i) {
+        double cost = opcodeCost(target, code[i].op) * runs[i];
+        report.total += cost;
+        if (code[i].kind.empty()) continue;
+        LineCost& line = lines[code[i].line];
+        line.line = code[i].line;
+        line.instructions++;
+        line.executions = std::max(line.executions, runs[i]);
+        line.cost += cost;
+        kinds[code[i].line].insert(code[i].kind);
+    }
+    for (auto& entry : lines) {
+        LineCost& line = entry.second;
+        for (const auto& kind : kinds[entry.first]) line.kinds += (line.kinds.empty() ? "" : ",") + kind;
+        auto depth = depths.find(entry.first);
+        if (depth != depths.end()) line.loopDepth = depth->second;
+        report.lines.push_back(line);
+    }
+    return report;
+}
+
+// indices of report.lines, most expensive first (ties by line number)
+static std::vector<size_t> byCost(const CostReport& report) {
+    std::vector<size_t> order(report.lines.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return report.lines[a].cost > report.lines[b].cost; });
+    return order;
+}
+
+static double share(const CostReport& report, const LineCost& line) {
+    return report.total > 0 ? 100 * line.cost / report.total : 0;
+}
+
+void writeCostReport(const CostReport& report, std::ostream& out) {
+    std::ostringstream text;
+    auto row = [&](const LineCost& line) {
+        text << std::setw(6) << line.line << "  " << std::left << std::setw(16) << line.kinds << std::right
+             << std::setw(7) << line.instructions << std::setw(6) << line.loopDepth << std::setprecision(0)
+             << std::setw(14) << line.executions << std::setw(16) << line.cost << std::setprecision(1)
+             << std::setw(8) << share(report, line) << "\n";
+    };
+    text << std::fixed;
+    text << "estimated cost by source line (target " << report.target << "; loops without a proven trip count"
+         << " assumed to run " << std::setprecision(0) << ASSUMED_LOOP_TRIPS << " times)\n";
+    std::string header = "  line  kind             instrs depth    executions            cost       %\n";
+    text << header;
+    for (const auto& line : report.lines) row(line);
+    text << "total estimated cost " << std::setprecision(0) << report.total << "\n";
+
+    std::vector<size_t> order = byCost(report);
+    if (order.size() > HOTTEST_LINES) order.resize(HOTTEST_LINES);
+    text << "\nmost expensive lines\n" << header;
+    for (size_t i : order) row(report.lines[i]);
+    std::string result = text.str();
+    out.write(result.data(), result.size());
+}
+
+void writeCostReportJson(const CostReport& report, std::ostream& out) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    text << "{\n  \"target\": \"" << report.target << "\",\n  \"assumed_loop_trips\": " << ASSUMED_LOOP_TRIPS
+         << ",\n  \"opcode_costs\": {";
+    const char* ops[] = {"LOAD", "STORE", "ADD", "SUB", "MULT", "DIV", "READ", "WRITE", "BR", "BRZERO", "NOOP", "STOP"};
+    const char* separator = "";
+    for (const char* op : ops) {
+        text << separator << "\"" << op << "\": " << opcodeCost(report.target, op);
+        separator = ", ";
+    }
+    text << "},\n  \"total_cost\": " << report.total << ",\n  \"lines\": [\n";
+    for (size_t i = 0; i < report.lines.size(); ++i) {
+        const LineCost& line = report.lines[i];
+        text << "    {\"line\": " << line.line << ", \"kinds\": \"" << line.kinds << "\", \"instructions\": "
+             << line.instructions << ", \"loop_depth\": " << line.loopDepth << ", \"executions\": "
+             << line.executions << ", \"cost\": " << line.cost << ", \"percent\": " << share(report, line) << "}"
+             << (i + 1 < report.lines.size() ? "," : "") << "\n";
+    }
+    text << "  ],\n  \"by_cost\": [";
+    separator = "";
+    for (size_t i : byCost(report)) {
+        text << separator << report.lines[i].line;
+        separator = ", ";
+    }
+    text << "]\n}\n";
+    std::string result = text.str();
+    out.write(result.data(), result.size());
+}
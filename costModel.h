@@ -0,0 +1,46 @@
+#ifndef COST_MODEL_H
+#define COST_MODEL_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "instr.h"
+#include "node.h"
+
+// static estimate of where a compiled program spends its time, before running it
+// (--cost-report). each instruction's opcode cost for the target is weighted by how often
+// it is expected to run, estimated from the generated code: code inside a loop runs the
+// loop's proven trip count (CodegenStats::loopTrips) or ASSUMED_LOOP_TRIPS times per entry,
+// each arm of a conditional branch half as often as the branch, and subroutine bodies kept
+// out of line as often as their calls together. costs are then summed per source line
+// using the line each instruction is stamped with (the same attribution as the .map).
+
+const double ASSUMED_LOOP_TRIPS = 10;
+
+struct LineCost {
+    int line = 0;
+    std::string kinds;          // statement kinds with code on the line, as in the .map
+    int instructions = 0;
+    int loopDepth = 0;          // loop statements around the line in the source
+    double executions = 0;      // estimated runs of its most frequent instruction
+    double cost = 0;            // opcode cost times estimated runs, over its instructions
+};
+
+struct CostReport {
+    std::string target;
+    double total = 0;
+    std::vector<LineCost> lines;    // by line number
+};
+
+// cost of one instruction on a target (vm, fso or x86_64)
+int opcodeCost(const std::string& target, const std::string& op);
+
+CostReport estimateCost(const std::vector<Instr>& code, Node* root, const std::map<int, long long>& loopTrips,
+                        const std::string& target);
+
+// table by line number, then the most expensive lines
+void writeCostReport(const CostReport& report, std::ostream& out);
+void writeCostReportJson(const CostReport& report, std::ostream& out);
+
+#endif
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "inputSource.h"
+
+MappedFileSource::~MappedFileSource() {
+    if (mapping) munmap(mapping, size);
+}
+
+bool MappedFileSource::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path;
+        return false;
+    }
+    bool ok = open(fd, error);
+    ::close(fd);
+    if (!ok) error = "could not read " + path;
+    return ok;
+}
+
+bool MappedFileSource::open(int fd, std::string& error) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size = static_cast<size_t>(st.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            mapping = mapped;
+            const char* text = static_cast<const char*>(mapping);
+            reset(text, text + size);
+            return true;
+        }
+    }
+    // not mappable: read it all
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t got = ::read(fd, chunk, sizeof(chunk));
+        if (got < 0) {
+            error = "could not read input";
+            return false;
+        }
+        if (got == 0) break;
+        copy.insert(copy.end(), chunk, chunk + got);
+    }
+    reset(copy.data(), copy.data() + copy.size());
+    return true;
+}
+
+const size_t StreamSource::CHUNK;
+
+// make at least n characters available from pos, keeping the unread tail of the buffer
+bool StreamSource::fill(size_t n) {
+    if (pos > 0) {
+        std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+        end -= pos;
+        pos = 0;
+    }
+    while (end < n && in) {
+        size_t want = std::max(n - end, CHUNK);
+        if (buffer.size() < end + want) buffer.resize(end + want);
+        in.read(buffer.data() + end, static_cast<std::streamsize>(want));
+        end += static_cast<size_t>(in.gcount());
+    }
+    return end >= n;
+}
@@ -0,0 +1,92 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+// where the scanner reads source text from. every source is a cursor with the same
+// three inline members, so initScanner<Source> compiles to direct code for each one:
+//
+//   bool ensure(size_t n)   at least n characters are available from the cursor
+//                           (a chunked source reads more to make it so); false near the end
+//   char peek(size_t k)     the character k past the cursor; needs ensure(k + 1)
+//   void advance(size_t n)  move the cursor on; needs ensure(n)
+//
+// the contiguous sources reduce these to pointer arithmetic.
+
+// text already in memory; the caller keeps it alive
+class BufferSource {
+    public:
+        BufferSource(const char* begin, const char* end) : pos(begin), end(end) {}
+
+        bool ensure(size_t n) const { return static_cast<size_t>(end - pos) >= n; }
+        char peek(size_t k) const { return pos[k]; }
+        void advance(size_t n) { pos += n; }
+
+    protected:
+        BufferSource() = default;
+        void reset(const char* begin, const char* end) { pos = begin; this->end = end; }
+
+    private:
+        const char* pos = nullptr;
+        const char* end = nullptr;
+};
+
+// a string owned by the source, for tests and generated programs
+class StringSource : public BufferSource {
+    public:
+        explicit StringSource(std::string text) : text(std::move(text)) {
+            reset(this->text.data(), this->text.data() + this->text.size());
+        }
+        StringSource(const StringSource&) = delete;
+        StringSource& operator=(const StringSource&) = delete;
+
+    private:
+        std::string text;
+};
+
+// a file mapped into memory. files that cannot be mapped (empty ones, pipes, terminals)
+// are read into memory instead, so open only fails if the file cannot be read at all
+class MappedFileSource : public BufferSource {
+    public:
+        MappedFileSource() = default;
+        ~MappedFileSource();
+        MappedFileSource(const MappedFileSource&) = delete;
+        MappedFileSource& operator=(const MappedFileSource&) = delete;
+
+        bool open(const std::string& path, std::string& error);
+        // an already open descriptor (such as stdin redirected from a file); not closed
+        bool open(int fd, std::string& error);
+
+        // whether the text is mapped rather than copied
+        bool mapped() const { return mapping != nullptr; }
+
+    private:
+        void* mapping = nullptr;
+        size_t size = 0;
+        std::vector<char> copy;
+};
+
+// a stream read in fixed-size chunks, for input that is neither a file nor in memory
+// (stdin from a pipe or terminal). only lookahead past the end of a chunk copies text
+class StreamSource {
+    public:
+        static const size_t CHUNK = 64 * 1024;
+
+        explicit StreamSource(std::istream& in) : in(in) {}
+
+        bool ensure(size_t n) { return end - pos >= n || fill(n); }
+        char peek(size_t k) const { return buffer[pos + k]; }
+        void advance(size_t n) { pos += n; }
+
+    private:
+        bool fill(size_t n);
+
+        std::istream& in;
+        std::vector<char> buffer;
+        size_t pos = 0, end = 0;
+};
+
+#endif
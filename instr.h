@@ -0,0 +1,29 @@
+#ifndef INSTR_H
+#define INSTR_H
+
+#include <string>
+#include <vector>
+
+// one accumulator machine instruction; label is empty unless the instruction is a branch target.
+// line and kind name the source statement that produced it (0 and "" when none did)
+struct Instr {
+    std::string label;
+    std::string op;
+    std::string arg;
+    int line;
+    std::string kind;
+};
+
+// one storage cell of the data section and its initial value
+struct DataCell {
+    std::string name;
+    int value;
+};
+
+// generated program: instructions (ending in STOP) followed by the storage section
+struct AsmProgram {
+    std::vector<Instr> code;
+    std::vector<DataCell> data;
+};
+
+#endif
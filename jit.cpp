@@ -0,0 +1,284 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_SUPPORTED 1
+#endif
+
+// host state reachable from generated code (passed in r13)
+struct JitContext {
+    int32_t failed;          // set by a callback that could not complete; must stay first
+    std::istream* in;
+    std::ostream* out;
+};
+
+// error codes returned by generated code
+enum JitStatus { JIT_OK = 0, JIT_READ_FAILED = 1, JIT_DIVIDE_BY_ZERO = 2 };
+
+static int32_t jitRead(JitContext* ctx) {
+    long long value = 0;
+    if (!(*ctx->in >> value)) {
+        ctx->failed = 1;
+        return 0;
+    }
+    return static_cast<int32_t>(value);
+}
+
+static void jitWrite(JitContext* ctx, int32_t value) {
+    *ctx->out << value << '\n';
+}
+
+#ifdef JIT_SUPPORTED
+
+// ---------------------------------------------------------------------------
+// x86-64 encoding
+//
+// register use: ebp = ACC, rbx = cell base, r13 = JitContext*, ecx/eax/edx scratch.
+// cells are addressed as [rbx + disp32]; all three registers are callee saved, so
+// they survive the host callbacks.
+// ---------------------------------------------------------------------------
+
+class Emitter {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void byte(uint8_t b) { bytes.push_back(b); }
+        void bytes2(uint8_t a, uint8_t b) { byte(a); byte(b); }
+        void imm32(int32_t v) {
+            uint32_t u = static_cast<uint32_t>(v);
+            for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(u >> (8 * i)));
+        }
+        void imm64(uint64_t v) {
+            for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(v >> (8 * i)));
+        }
+        // opcode bytes then a [rbx + disp32] operand with the given reg field
+        void cellOperand(uint8_t reg, int32_t cell) {
+            byte(static_cast<uint8_t>(0x80 | (reg << 3) | 3));
+            imm32(cell * 4);
+        }
+        // rel32 placeholder; returns its offset for patching
+        size_t rel32() {
+            size_t at = bytes.size();
+            imm32(0);
+            return at;
+        }
+        void patch(size_t at, size_t target) {
+            int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+            std::memcpy(&bytes[at], &rel, 4);
+        }
+        void epilogue() {
+            bytes2(0x41, 0x5D);   // pop r13
+            byte(0x5B);           // pop rbx
+            byte(0x5D);           // pop rbp
+            byte(0xC3);           // ret
+        }
+        void callHost(const void* fn) {
+            bytes2(0x4C, 0x89); byte(0xEF);  // mov rdi, r13
+            bytes2(0x48, 0xB8);              // mov rax, imm64
+            imm64(reinterpret_cast<uint64_t>(fn));
+            bytes2(0xFF, 0xD0);              // call rax
+        }
+};
+
+// condition code of the jcc used for each conditional branch after test ebp, ebp
+static uint8_t conditionCode(VMOp op) {
+    switch (op) {
+        case VMOp::BRNEG: return 0x88;   // js
+        case VMOp::BRZNEG: return 0x8E;  // jle
+        case VMOp::BRPOS: return 0x8F;   // jg
+        case VMOp::BRZPOS: return 0x89;  // jns
+        default: return 0x84;            // je (BRZERO)
+    }
+}
+
+JitProgram::~JitProgram() {
+    if (code) munmap(code, mapped);
+}
+
+bool JitProgram::compile(const VMImage& image, std::string& error) {
+    Emitter e;
+    std::vector<std::pair<size_t, int32_t>> branchFixups;  // rel32 offset -> instruction index
+    std::vector<size_t> readFixups, divFixups;             // rel32 offsets -> error stubs
+
+    // prologue: save callee-saved registers (leaves rsp 16-byte aligned for calls)
+    e.byte(0x55);                          // push rbp
+    e.byte(0x53);                          // push rbx
+    e.bytes2(0x41, 0x55);                  // push r13
+    e.bytes2(0x48, 0x89); e.byte(0xFB);    // mov rbx, rdi
+    e.bytes2(0x49, 0x89); e.byte(0xF5);    // mov r13, rsi
+    e.bytes2(0x31, 0xED);                  // xor ebp, ebp
+    prologueSize = e.bytes.size();
+
+    offsets.assign(image.code.size(), 0);
+    for (size_t i = 0; i < image.code.size(); ++i) {
+        offsets[i] = e.bytes.size();
+        const VMInstr& instr = image.code[i];
+        int32_t x = instr.operand;
+        switch (instr.op) {
+            case VMOp::READ:
+                e.callHost(reinterpret_cast<const void*>(&jitRead));
+                e.bytes2(0x41, 0x83); e.bytes2(0x7D, 0x00); e.byte(0x00);  // cmp dword [r13], 0
+                e.bytes2(0x0F, 0x85); readFixups.push_back(e.rel32());      // jne read error
+                e.byte(0x89); e.cellOperand(0, x);                          // mov [cell], eax
+                break;
+            case VMOp::WRITE_M:
+                e.byte(0x8B); e.cellOperand(6, x);                          // mov esi, [cell]
+                e.callHost(reinterpret_cast<const void*>(&jitWrite));
+                break;
+            case VMOp::WRITE_I:
+                e.byte(0xBE); e.imm32(x);                                   // mov esi, imm32
+                e.callHost(reinterpret_cast<const void*>(&jitWrite));
+                break;
+            case VMOp::LOAD_M: e.byte(0x8B); e.cellOperand(5, x); break;    // mov ebp, [cell]
+            case VMOp::LOAD_I: e.byte(0xBD); e.imm32(x); break;             // mov ebp, imm32
+            case VMOp::STORE: e.byte(0x89); e.cellOperand(5, x); break;     // mov [cell], ebp
+            case VMOp::ADD_M: e.byte(0x03); e.cellOperand(5, x); break;     // add ebp, [cell]
+            case VMOp::ADD_I: e.bytes2(0x81, 0xC5); e.imm32(x); break;      // add ebp, imm32
+            case VMOp::SUB_M: e.byte(0x2B); e.cellOperand(5, x); break;     // sub ebp, [cell]
+            case VMOp::SUB_I: e.bytes2(0x81, 0xED); e.imm32(x); break;      // sub ebp, imm32
+            case VMOp::MULT_M: e.bytes2(0x0F, 0xAF); e.cellOperand(5, x); break;  // imul ebp, [cell]
+            case VMOp::MULT_I: e.bytes2(0x69, 0xED); e.imm32(x); break;     // imul ebp, ebp, imm32
+            case VMOp::DIV_M:
+            case VMOp::DIV_I:
+                if (instr.op == VMOp::DIV_M) { e.byte(0x8B); e.cellOperand(1, x); }  // mov ecx, [cell]
+                else { e.byte(0xB9); e.imm32(x); }                                    // mov ecx, imm32
+                e.bytes2(0x85, 0xC9);                                       // test ecx, ecx
+                e.bytes2(0x0F, 0x84); divFixups.push_back(e.rel32());       // je divide error
+                e.bytes2(0x83, 0xF9); e.byte(0xFF);                         // cmp ecx, -1
+                e.bytes2(0x75, 0x04);                                       // jne idiv
+                e.bytes2(0xF7, 0xDD);                                       // neg ebp (wraps like the VM)
+                e.bytes2(0xEB, 0x07);                                       // jmp done
+                e.bytes2(0x89, 0xE8);                                       // idiv: mov eax, ebp
+                e.byte(0x99);                                               // cdq
+                e.bytes2(0xF7, 0xF9);                                       // idiv ecx
+                e.bytes2(0x89, 0xC5);                                       // mov ebp, eax
+                break;
+            case VMOp::BR:
+                e.byte(0xE9); branchFixups.push_back({e.rel32(), x});      // jmp
+                break;
+            case VMOp::BRNEG:
+            case VMOp::BRZNEG:
+            case VMOp::BRPOS:
+            case VMOp::BRZPOS:
+            case VMOp::BRZERO:
+                e.bytes2(0x85, 0xED);                                       // test ebp, ebp
+                e.bytes2(0x0F, conditionCode(instr.op));                    // jcc
+                branchFixups.push_back({e.rel32(), x});
+                break;
+            case VMOp::NOOP:
+                break;
+            case VMOp::STOP:
+                e.bytes2(0x31, 0xC0);                                       // xor eax, eax
+                e.epilogue();
+                break;
+        }
+    }
+
+    // error exits
+    size_t readError = e.bytes.size();
+    e.byte(0xB8); e.imm32(JIT_READ_FAILED); e.epilogue();
+    size_t divError = e.bytes.size();
+    e.byte(0xB8); e.imm32(JIT_DIVIDE_BY_ZERO); e.epilogue();
+
+    for (const auto& fixup : branchFixups) e.patch(fixup.first, offsets[fixup.second]);
+    for (size_t at : readFixups) e.patch(at, readError);
+    for (size_t at : divFixups) e.patch(at, divError);
+
+    // copy into a fresh mapping, then flip it to read+execute
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    mapped = (e.bytes.size() + page - 1) / page * page;
+    void* mem = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        error = "mmap failed";
+        return false;
+    }
+    std::memcpy(mem, e.bytes.data(), e.bytes.size());
+    if (mprotect(mem, mapped, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, mapped);
+        error = "mprotect failed";
+        return false;
+    }
+    code = mem;
+    size = e.bytes.size();
+    return true;
+}
+
+VMResult JitProgram::run(const VMImage& image, std::istream& in, std::ostream& out) const {
+    VMResult result;
+    result.memory = image.memory;
+    if (result.memory.empty()) result.memory.push_back(0); // keep the base pointer valid
+    JitContext ctx = {0, &in, &out};
+    typedef int (*Entry)(int32_t*, JitContext*);
+    Entry entry = reinterpret_cast<Entry>(code);
+    int status = entry(result.memory.data(), &ctx);
+    result.memory.resize(image.memory.size());
+    out.flush();
+    if (status == JIT_READ_FAILED) {
+        result.ok = false;
+        result.error = "READ: expected an integer on input";
+    } else if (status == JIT_DIVIDE_BY_ZERO) {
+        result.ok = false;
+        result.error = "DIV: division by zero";
+    }
+    return result;
+}
+
+bool JitProgram::writePerfMap(const VMImage& image, const std::string& name, std::string& error) const {
+    std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+    std::ofstream map(path, std::ios::app);
+    if (!map) {
+        error = "could not open " + path;
+        return false;
+    }
+    // one symbol for the prologue, then one per labelled region of code
+    uintptr_t base = reinterpret_cast<uintptr_t>(code);
+    char line[256];
+    std::snprintf(line, sizeof line, "%lx %lx fs25s1:%s:entry\n", static_cast<unsigned long>(base),
+                  static_cast<unsigned long>(prologueSize), name.c_str());
+    map << line;
+    size_t start = prologueSize;
+    std::string region = "start";
+    for (size_t i = 0; i <= image.code.size(); ++i) {
+        bool boundary = i == image.code.size() || !image.labels[i].empty();
+        if (!boundary) continue;
+        size_t end = i == image.code.size() ? size : offsets[i];
+        if (end > start) {
+            std::snprintf(line, sizeof line, "%lx %lx fs25s1:%s:%s\n", static_cast<unsigned long>(base + start),
+                          static_cast<unsigned long>(end - start), name.c_str(), region.c_str());
+            map << line;
+        }
+        if (i < image.code.size()) region = image.labels[i];
+        start = end;
+    }
+    return true;
+}
+
+#else
+
+JitProgram::~JitProgram() {}
+
+bool JitProgram::compile(const VMImage&, std::string& error) {
+    error = "the JIT is only available on x86-64 Linux";
+    return false;
+}
+
+VMResult JitProgram::run(const VMImage& image, std::istream&, std::ostream&) const {
+    VMResult result;
+    result.memory = image.memory;
+    result.ok = false;
+    result.error = "the JIT is only available on x86-64 Linux";
+    return result;
+}
+
+bool JitProgram::writePerfMap(const VMImage&, const std::string&, std::string& error) const {
+    error = "the JIT is only available on x86-64 Linux";
+    return false;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "vm.h"
+
+// x86-64 JIT for decoded programs: ACC lives in a machine register, cells in a flat
+// int32 block, READ/WRITE call back into the host. only available on x86-64 Linux.
+class JitProgram {
+    public:
+        JitProgram() = default;
+        JitProgram(const JitProgram&) = delete;
+        JitProgram& operator=(const JitProgram&) = delete;
+        ~JitProgram();
+
+        // translate image to native code in an executable buffer
+        bool compile(const VMImage& image, std::string& error);
+
+        // execute with a fresh copy of the image's storage; steps is not counted
+        VMResult run(const VMImage& image, std::istream& in, std::ostream& out) const;
+
+        // append symbols for the generated code to /tmp/perf-<pid>.map so perf can
+        // attribute samples to program labels
+        bool writePerfMap(const VMImage& image, const std::string& name, std::string& error) const;
+
+        size_t codeSize() const { return size; }
+
+    private:
+        void* code = nullptr;
+        size_t size = 0;
+        size_t mapped = 0;
+        std::vector<size_t> offsets;   // native offset of each instruction
+        size_t prologueSize = 0;
+};
+
+#endif
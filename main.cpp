@@ -1,47 +1,409 @@
 #include "parser.h"
 #include "staticSemantics.h"
 #include "compiler.h"
+#include "costModel.h"
+#include "vm.h"
+#include "jit.h"
+#include "x86Backend.h"
+#include "objectFile.h"
+#include "timing.h"
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] <name>" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --unroll-budget=N   max instructions a loop may unroll to (0 disables; default 64 at -O2, 0 at -O0/-O1)" << std::endl;
+    std::cerr << "  --target=T          output format: vm (accumulator .asm, default), fso (binary object) or x86_64 (GNU as .s)" << std::endl;
+    std::cerr << "  --inline-budget=N   instructions inlining a subroutine may add (negative never inlines; default 16 at -O2, 0 at -O1, never at -O0)" << std::endl;
+    std::cerr << "  --no-strength-reduce  keep multiplications by loop counters and the counters themselves" << std::endl;
+    std::cerr << "  -O0, -O1, -O2       optimization level (default -O2)" << std::endl;
+    std::cerr << "  --partial-eval      run input-independent code at compile time, emitting only what depends on scan" << std::endl;
+    std::cerr << "  --pe-budget=N       statements and loop tests --partial-eval may run (default 1000000)" << std::endl;
+    std::cerr << "  --codegen-threads=N generate code on N threads (0 one per core, default 1); output is unchanged" << std::endl;
+    std::cerr << "  --passes=A,B,...    run exactly these passes over the generated code, in order" << std::endl;
+    std::cerr << "  --rewrites=FILE     expression rewrite table from tools/superopt (default: the one built in, at -O1 and -O2)" << std::endl;
+    std::cerr << "  --no-rewrites       keep the template code for every expression" << std::endl;
+    std::cerr << "  --stats             report time and changes of each pass on stderr" << std::endl;
+    std::cerr << "  --run               execute the compiled program in the built-in interpreter" << std::endl;
+    std::cerr << "  --exec-counts       with --run, report per-instruction execution counts on stderr" << std::endl;
+    std::cerr << "  --jit               execute the compiled program as native x86-64 code" << std::endl;
+    std::cerr << "  --perf-map          with --jit, write /tmp/perf-<pid>.map for perf" << std::endl;
+    std::cerr << "  --bench-exec        time the interpreter against the JIT on the same stdin input" << std::endl;
+    std::cerr << "  --line-map          write <name>.map: the source line and statement kind of each instruction range" << std::endl;
+    std::cerr << "  --cost-report[=FILE] estimate each source line's share of run time on stderr (FILE.json for JSON)" << std::endl;
+    std::cerr << "  --instrument        count cond arms, loop bodies and exits; writes <name>.probes, and <name>.prof with --run" << std::endl;
+    std::cerr << "  --profile-use=FILE  lay out conds and unroll loops using counts from an instrumented run" << std::endl;
+    std::cerr << "  --time-passes       report time, allocations and peak RSS per compiler phase on stderr" << std::endl;
+    std::cerr << "  --trace=FILE        write compiler phase spans to FILE in Chrome trace format" << std::endl;
+}
+
+// --cost-report: text on stderr, or to a file (JSON if its name ends in .json)
+static void writeCostReport(const CostReport& report, const std::string& path) {
+    if (path.empty()) {
+        writeCostReport(report, std::cerr);
+        return;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not open output file: " << path << std::endl;
+        std::exit(1);
+    }
+    if (path.size() > 5 && path.compare(path.size() - 5, 5, ".json") == 0) writeCostReportJson(report, out);
+    else writeCostReport(report, out);
+}
+
+// AST size for --time-passes
+static long long countNodes(Node* root) {
+    if (!root) return 0;
+    long long n = 1;
+    for (Node* child : root->children) n += countNodes(child);
+    return n;
+}
+
+// how to execute the compiled program, if at all
+struct RunOptions {
+    bool run = false;          // interpret after compiling
+    bool execCounts = false;   // report per-instruction counts
+    bool jit = false;          // execute natively instead of interpreting
+    bool perfMap = false;      // write /tmp/perf-<pid>.map for the JIT code
+    bool benchExec = false;    // time interpreter against JIT on the same input
+    std::vector<std::string> probes;  // instrumented: the last probes.size() outputs are counts
+};
+
+// profile lines: probe-name count ('#' starts a comment)
+static bool readProfile(const std::string& path, std::map<std::string, long long>& profile) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream words(line);
+        std::string probe;
+        long long count;
+        if (!(words >> probe >> count)) return false;
+        profile[probe] = count;
+    }
+    return true;
+}
+
+// split the probe counts off the end of an instrumented run's output into <name>.prof
+static bool writeProfile(const std::string& name, const std::vector<std::string>& probes, std::string& output) {
+    // walk back one line per probe
+    size_t first = output.size();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        if (first == 0) return false;
+        size_t newline = first >= 2 ? output.rfind('\n', first - 2) : std::string::npos;
+        first = newline == std::string::npos ? 0 : newline + 1;
+    }
+    std::ofstream out(name + ".prof");
+    if (!out) return false;
+    out << "# execution counts from an instrumented run of " << name << "\n";
+    std::istringstream counts(output.substr(first));
+    for (const auto& probe : probes) {
+        long long count = 0;
+        counts >> count;
+        out << probe << " " << count << "\n";
+    }
+    output.erase(first);
+    return static_cast<bool>(out);
+}
+
+// time the interpreter and the JIT over the same stdin input (best of several runs)
+static int benchExecution(const VMImage& image, const std::string& name) {
+    std::string input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+    const int reps = 5;
+    typedef std::chrono::steady_clock Clock;
+    auto millis = [](Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    double interpBest = 0, jitBest = 0;
+    std::string interpOut, jitOut;
+    VMResult interpResult, jitResult;
+    for (int i = 0; i < reps; ++i) {
+        std::istringstream in(input);
+        std::ostringstream out;
+        auto start = Clock::now();
+        interpResult = runProgram(image, in, out);
+        double t = millis(Clock::now() - start);
+        if (i == 0 || t < interpBest) interpBest = t;
+        interpOut = out.str();
+    }
+
+    JitProgram jit;
+    std::string error;
+    auto compileStart = Clock::now();
+    if (!jit.compile(image, error)) {
+        std::cerr << "JIT unavailable: " << error << std::endl;
+        return 1;
+    }
+    double compileTime = millis(Clock::now() - compileStart);
+    for (int i = 0; i < reps; ++i) {
+        std::istringstream in(input);
+        std::ostringstream out;
+        auto start = Clock::now();
+        jitResult = jit.run(image, in, out);
+        double t = millis(Clock::now() - start);
+        if (i == 0 || t < jitBest) jitBest = t;
+        jitOut = out.str();
+    }
+
+    std::cout << name << ": " << interpResult.steps << " instructions executed\n";
+    std::cout << "  interpreter  " << interpBest << " ms\n";
+    std::cout << "  jit          " << jitBest << " ms (+" << compileTime << " ms compile, "
+              << jit.codeSize() << " bytes)\n";
+    if (jitBest > 0) std::cout << "  speedup      " << interpBest / jitBest << "x\n";
+    if (interpOut != jitOut || interpResult.ok != jitResult.ok) {
+        std::cerr << "MISMATCH: interpreter and JIT disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// execute a compiled program in-process, reading scan input from stdin
+static int runCompiled(const AsmProgram& program, const std::string& name, const RunOptions& run) {
+    VMImage image;
+    std::string error;
+    if (!decodeProgram(program, image, error)) {
+        std::cerr << "Could not load program: " << error << std::endl;
+        return 1;
+    }
+    if (run.benchExec) return benchExecution(image, name);
+
+    // an instrumented run's output is captured so the trailing counts can be split off
+    std::ostringstream captured;
+    std::ostream& output = run.probes.empty() ? std::cout : captured;
+    VMResult result;
+    if (run.jit) {
+        JitProgram jit;
+        if (!jit.compile(image, error)) {
+            std::cerr << "JIT unavailable: " << error << std::endl;
+            return 1;
+        }
+        if (run.perfMap && !jit.writePerfMap(image, name, error)) {
+            std::cerr << "Could not write perf map: " << error << std::endl;
+        }
+        result = jit.run(image, std::cin, output);
+    } else {
+        result = runProgram(image, std::cin, output, run.execCounts);
+        if (run.execCounts) printExecutionCounts(image, result, std::cerr);
+    }
+    if (!result.ok) {
+        std::cout << captured.str();
+        std::cerr << "Runtime error: " << result.error << std::endl;
+        return 1;
+    }
+    if (!run.probes.empty()) {
+        std::string text = captured.str();
+        if (!writeProfile(name, run.probes, text)) {
+            std::cerr << "Could not write profile: " << name << ".prof" << std::endl;
+            return 1;
+        }
+        std::cout << text;
+    }
+    return 0;
+}
 
 int main(int argc, char **argv) {
-    if (argc == 2) { // filename provided
-        std::string filename = argv[1];
+    CodegenOptions options;
+    std::string name;
+    RunOptions run;
+    std::string target = "vm";
+    bool timePasses = false;
+    int optLevel = 2;
+    int unrollBudget = -1;
+    int inlineBudget = 0;
+    bool inlineGiven = false;
+    bool strengthReduce = true;
+    std::vector<std::string> passes;
+    bool passesGiven = false;
+    bool lineMap = false;
+    bool costReport = false;
+    std::string costReportPath;
+    std::string tracePath;
+    bool rewrites = true;
+    std::string rewritesPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 16, "--unroll-budget=") == 0) {
+            unrollBudget = std::stoi(arg.substr(16));
+        } else if (arg.compare(0, 16, "--inline-budget=") == 0) {
+            inlineBudget = std::stoi(arg.substr(16));
+            inlineGiven = true;
+        } else if (arg == "--no-strength-reduce") {
+            strengthReduce = false;
+        } else if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            optLevel = arg[2] - '0';
+        } else if (arg == "--partial-eval") {
+            options.partialEval = true;
+        } else if (arg.compare(0, 12, "--pe-budget=") == 0) {
+            options.peBudget = std::stoll(arg.substr(12));
+        } else if (arg.compare(0, 18, "--codegen-threads=") == 0) {
+            options.codegenThreads = std::stoi(arg.substr(18));
+        } else if (arg.compare(0, 9, "--passes=") == 0) {
+            std::string error;
+            if (!parsePassList(arg.substr(9), passes, error)) {
+                std::cerr << "Bad --passes: " << error << std::endl;
+                return 1;
+            }
+            passesGiven = true;
+        } else if (arg.compare(0, 11, "--rewrites=") == 0) {
+            rewritesPath = arg.substr(11);
+        } else if (arg == "--no-rewrites") {
+            rewrites = false;
+        } else if (arg.compare(0, 9, "--target=") == 0) {
+            target = arg.substr(9);
+            if (target != "vm" && target != "fso" && target != "x86_64") {
+                std::cerr << "Unknown target: " << target << std::endl;
+                return 1;
+            }
+        } else if (arg == "--stats") {
+            options.printStats = true;
+        } else if (arg == "--run") {
+            run.run = true;
+        } else if (arg == "--exec-counts") {
+            run.execCounts = true;
+        } else if (arg == "--jit") {
+            run.run = run.jit = true;
+        } else if (arg == "--perf-map") {
+            run.perfMap = true;
+        } else if (arg == "--bench-exec") {
+            run.run = run.benchExec = true;
+        } else if (arg == "--line-map") {
+            lineMap = true;
+        } else if (arg == "--cost-report") {
+            costReport = true;
+        } else if (arg.compare(0, 14, "--cost-report=") == 0) {
+            costReport = true;
+            costReportPath = arg.substr(14);
+        } else if (arg == "--instrument") {
+            options.instrument = true;
+        } else if (arg.compare(0, 14, "--profile-use=") == 0) {
+            if (!readProfile(arg.substr(14), options.profile)) {
+                std::cerr << "Could not read profile: " << arg.substr(14) << std::endl;
+                return 1;
+            }
+        } else if (arg == "--time-passes") {
+            timePasses = true;
+        } else if (arg.compare(0, 8, "--trace=") == 0) {
+            tracePath = arg.substr(8);
+        } else if (arg.compare(0, 1, "-") == 0 || !name.empty()) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            name = arg;
+        }
+    }
+
+    // -O picks the pipeline and unroll budget; explicit flags win whatever their order
+    options.passes = passesGiven ? passes : pipelineForLevel(optLevel);
+    options.unrollBudget = unrollBudget >= 0 ? unrollBudget : unrollBudgetForLevel(optLevel);
+    options.inlineBudget = inlineGiven ? inlineBudget : inlineBudgetForLevel(optLevel);
+    options.strengthReduce = strengthReduce && optLevel >= 2;
+    // a table named on the command line is used at any level; the built-in one only
+    // when optimizing
+    if (rewrites && !rewritesPath.empty()) {
+        std::string error;
+        if (!readRewrites(rewritesPath, options.rewrites, error)) {
+            std::cerr << "Could not read rewrites: " << error << std::endl;
+            return 1;
+        }
+    } else if (rewrites && optLevel >= 1) {
+        options.rewrites = builtinRewrites();
+    }
+
+    // the source is mapped when it is a file (named, or redirected to stdin) and read
+    // into memory otherwise; either way the scanner runs over one contiguous buffer
+    MappedFileSource source;
+    std::string sourceError;
+    if (!name.empty()) { // filename provided
+        std::string filename = name;
         filename += ".fs25s1";
-        std::ifstream in(filename);
-        if (!in) {
+        if (!source.open(filename, sourceError)) {
             std::cerr << "Could not open file: " << filename << std::endl;
             std::exit(1);
         }
-        initScanner(in);
-        Node* root = parser();
-        STATSEM statsem = staticSemantics(root);
-        // create output file
-        std::string filename_out = argv[1];
-        std::ofstream out(filename_out + ".asm");
-        if (!out) {
-            std::cerr << "Could not open output file: " << filename_out + ".asm" << std::endl;
+    } else { // no filename read from stdin
+        std::cout << "Taking keyboard input" << std::endl;
+        if (!source.open(0, sourceError)) {
+            std::cerr << "Could not read keyboard input" << std::endl;
             std::exit(1);
         }
-        traversal(root, out, statsem);
-        out.close();
-    } else if (argc == 1) { // no filename read from stdin
-        std::cout << "Taking keyboard input" << std::endl;
-        initScanner(std::cin);
-        Node* root = parser();
-        STATSEM statsem = staticSemantics(root);
+    }
+    std::string base = name.empty() ? "a" : name;
+
+    if (timePasses || !tracePath.empty()) enableTiming();
+
+    AsmProgram program;
+    {
+        PhaseScope compile("compile");
+        {
+            PhaseScope phase("scan");
+            initScanner(source);
+        }
+        recordCount("tokens", static_cast<long long>(tokenCount()));
+        Node* root;
+        {
+            PhaseScope phase("parse");
+            root = parser();
+        }
+        if (timingEnabled()) recordCount("AST nodes", countNodes(root));
+        STATSEM statsem;
+        {
+            PhaseScope phase("semantics");
+            statsem = staticSemantics(root);
+        }
+        CodegenStats stats;
+        program = generateProgram(root, statsem, options, &stats);
+        run.probes = stats.probes;
+        if (options.instrument) {
+            // probe names in the order the program writes their counts after its own output
+            std::ofstream probes(base + ".probes");
+            for (const auto& probe : stats.probes) probes << probe << "\n";
+        }
+        if (costReport) writeCostReport(estimateCost(program.code, root, stats.loopTrips, target), costReportPath);
+
         // create output file
-        std::ofstream out("a.asm");
-        if (!out) {
-            std::cerr << "Could not open output file: a.asm" << std::endl;
-            std::exit(1);
+        PhaseScope phase("emit");
+        if (target == "fso") {
+            std::string error;
+            if (!writeObject(program, base + ".fso", error)) {
+                std::cerr << "Could not write object file: " << error << std::endl;
+                std::exit(1);
+            }
+        } else {
+            std::string filename_out = base + (target == "x86_64" ? ".s" : ".asm");
+            std::ofstream out(filename_out);
+            if (!out) {
+                std::cerr << "Could not open output file: " << filename_out << std::endl;
+                std::exit(1);
+            }
+            if (target == "x86_64") writeX86Assembly(program, out);
+            else writeAsm(program, out);
+            out.close();
+        }
+        if (lineMap) {
+            std::ofstream map(base + ".map");
+            if (!map) {
+                std::cerr << "Could not open output file: " << base << ".map" << std::endl;
+                std::exit(1);
+            }
+            writeLineMap(program, map);
         }
-        traversal(root, out, statsem);
-        out.close();
-    } else {
-        std::cerr << "Usage: " << argv[0] << " <name>" << std::endl;
-        return 1;
     }
+
+    if (timePasses) printTimingReport(std::cerr);
+    if (!tracePath.empty()) {
+        std::string error;
+        if (!writeChromeTrace(tracePath, error)) std::cerr << "Could not write trace: " << error << std::endl;
+    }
+
+    if (run.run) return runCompiled(program, base, run);
     return 0;
-}
\ No newline at end of file
+}
@@ -4,11 +4,25 @@
 #include <string>
 #include <vector>
 
+// one kind per grammar nonterminal; code that walks the tree dispatches on this,
+// type keeps the printable name
+enum class NodeKind {
+    Unknown, Program, Vars, VarList, Block, Stats, MStat, Stat,
+    Read, Print, Cond, Loop, Assign, Relational, Exp, M, N, R, Func, Call,
+};
+
 typedef struct Node {
+    NodeKind kind = NodeKind::Unknown;
     std::string type;
     std::vector<std::string> tokens;
     std::vector<int> line_numbers;
     std::vector<Node*> children;
 } Node;
 
+// statements whose generated code is attributed to a source line
+inline bool isStatement(NodeKind kind) {
+    return kind == NodeKind::Read || kind == NodeKind::Print || kind == NodeKind::Cond ||
+           kind == NodeKind::Loop || kind == NodeKind::Assign || kind == NodeKind::Call;
+}
+
 #endif
\ No newline at end of file
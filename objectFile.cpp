@@ -0,0 +1,245 @@
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "objectFile.h"
+
+static const char MAGIC[4] = {'F', 'S', 'O', 'B'};
+static const uint16_t VERSION = 1;
+static const size_t HEADER_SIZE = 32;
+static const size_t INSTR_SIZE = 8;
+
+// opcode names in VMOp order, with whether the operand is immediate
+struct OpName {
+    const char* name;
+    bool immediate;
+};
+static const OpName opNames[] = {
+    {"READ", false}, {"WRITE", false}, {"WRITE", true}, {"LOAD", false}, {"LOAD", true}, {"STORE", false},
+    {"ADD", false}, {"ADD", true}, {"SUB", false}, {"SUB", true}, {"MULT", false}, {"MULT", true},
+    {"DIV", false}, {"DIV", true}, {"BR", false}, {"BRNEG", false}, {"BRZNEG", false}, {"BRPOS", false},
+    {"BRZPOS", false}, {"BRZERO", false}, {"NOOP", false}, {"STOP", false},
+};
+static const size_t OP_COUNT = sizeof(opNames) / sizeof(opNames[0]);
+
+static bool isBranchOp(VMOp op) {
+    return op >= VMOp::BR && op <= VMOp::BRZERO;
+}
+
+static uint32_t fnv1a(const unsigned char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void put16(std::string& buf, uint16_t v) {
+    buf.push_back(static_cast<char>(v & 0xFF));
+    buf.push_back(static_cast<char>(v >> 8));
+}
+
+static void put32(std::string& buf, uint32_t v) {
+    for (int i = 0; i < 4; ++i) buf.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+static uint32_t get32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+bool writeObject(const AsmProgram& program, const std::string& path, std::string& error) {
+    VMImage image;
+    if (!decodeProgram(program, image, error)) return false;
+
+    // payload first so the header can carry its checksum
+    std::string payload;
+    payload.reserve(image.code.size() * INSTR_SIZE + image.memory.size() * 4);
+    for (const auto& instr : image.code) {
+        payload.push_back(static_cast<char>(instr.op));
+        payload.append(3, '\0');
+        put32(payload, static_cast<uint32_t>(instr.operand));
+    }
+    for (int32_t value : image.memory) put32(payload, static_cast<uint32_t>(value));
+    uint32_t labelCount = 0;
+    for (size_t i = 0; i < image.labels.size(); ++i) {
+        if (image.labels[i].empty()) continue;
+        put32(payload, static_cast<uint32_t>(i));
+        labelCount++;
+    }
+    size_t namesStart = payload.size();
+    for (const auto& name : image.cellNames) payload.append(name.c_str(), name.size() + 1);
+    for (const auto& label : image.labels) {
+        if (!label.empty()) payload.append(label.c_str(), label.size() + 1);
+    }
+    uint32_t nameBytes = static_cast<uint32_t>(payload.size() - namesStart);
+
+    std::string file(MAGIC, sizeof MAGIC);
+    put16(file, VERSION);
+    put16(file, 0);
+    put32(file, static_cast<uint32_t>(image.code.size()));
+    put32(file, static_cast<uint32_t>(image.memory.size()));
+    put32(file, labelCount);
+    put32(file, nameBytes);
+    put32(file, fnv1a(reinterpret_cast<const unsigned char*>(payload.data()), payload.size()));
+    put32(file, 0);
+    file += payload;
+
+    // one write for the whole file
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = "could not open " + path;
+        return false;
+    }
+    size_t done = 0;
+    while (done < file.size()) {
+        ssize_t n = ::write(fd, file.data() + done, file.size() - done);
+        if (n <= 0) {
+            ::close(fd);
+            error = "could not write " + path;
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return true;
+}
+
+// validate and unpack a mapped object
+static bool parseObject(const unsigned char* data, size_t size, VMImage& image, std::string& error) {
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof MAGIC) != 0) {
+        error = "not an object file";
+        return false;
+    }
+    uint16_t version = static_cast<uint16_t>(data[4] | data[5] << 8);
+    if (version != VERSION) {
+        error = "unsupported object version " + std::to_string(version);
+        return false;
+    }
+    uint64_t codeCount = get32(data + 8), cellCount = get32(data + 12);
+    uint64_t labelCount = get32(data + 16), nameBytes = get32(data + 20);
+    uint64_t expected = HEADER_SIZE + codeCount * INSTR_SIZE + cellCount * 4 + labelCount * 4 + nameBytes;
+    if (expected != size) {
+        error = "truncated or oversized object file";
+        return false;
+    }
+    if (fnv1a(data + HEADER_SIZE, size - HEADER_SIZE) != get32(data + 24)) {
+        error = "checksum mismatch";
+        return false;
+    }
+
+    image = VMImage();
+    const unsigned char* p = data + HEADER_SIZE;
+    image.code.resize(codeCount);
+    for (uint64_t i = 0; i < codeCount; ++i, p += INSTR_SIZE) {
+        if (p[0] >= OP_COUNT) {
+            error = "bad opcode at instruction " + std::to_string(i + 1);
+            return false;
+        }
+        image.code[i] = {static_cast<VMOp>(p[0]), static_cast<int32_t>(get32(p + 4))};
+    }
+    image.memory.resize(cellCount);
+    for (uint64_t i = 0; i < cellCount; ++i, p += 4) image.memory[i] = static_cast<int32_t>(get32(p));
+    std::vector<uint32_t> labelAt(labelCount);
+    for (uint64_t i = 0; i < labelCount; ++i, p += 4) labelAt[i] = get32(p);
+
+    const char* names = reinterpret_cast<const char*>(p);
+    const char* end = names + nameBytes;
+    auto nextName = [&](std::string& out) {
+        const char* stop = static_cast<const char*>(std::memchr(names, '\0', end - names));
+        if (!stop) return false;
+        out.assign(names, stop);
+        names = stop + 1;
+        return true;
+    };
+    image.cellNames.resize(cellCount);
+    for (auto& name : image.cellNames) {
+        if (!nextName(name)) {
+            error = "bad name table";
+            return false;
+        }
+    }
+    image.labels.assign(codeCount, "");
+    for (uint32_t at : labelAt) {
+        if (at >= codeCount || !nextName(image.labels[at])) {
+            error = "bad label table";
+            return false;
+        }
+    }
+
+    // operands must stay in range before anything executes them
+    for (uint64_t i = 0; i < codeCount; ++i) {
+        const VMInstr& instr = image.code[i];
+        bool immediate = opNames[static_cast<int>(instr.op)].immediate;
+        uint64_t limit = isBranchOp(instr.op) ? codeCount : cellCount;
+        bool usesOperand = instr.op != VMOp::NOOP && instr.op != VMOp::STOP && !immediate;
+        if (usesOperand && (instr.operand < 0 || static_cast<uint64_t>(instr.operand) >= limit)) {
+            error = "operand out of range at instruction " + std::to_string(i + 1);
+            return false;
+        }
+    }
+    if (codeCount == 0 || image.code.back().op != VMOp::STOP) {
+        error = "program does not end in STOP";
+        return false;
+    }
+
+    AsmProgram program = imageToProgram(image);
+    for (const auto& instr : program.code) {
+        std::string text = instr.label.empty() ? "" : instr.label + ": ";
+        text += instr.op;
+        if (!instr.arg.empty()) text += " " + instr.arg;
+        image.text.push_back(text);
+    }
+    return true;
+}
+
+bool loadObject(const std::string& path, VMImage& image, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        error = "could not read " + path;
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "could not map " + path;
+        return false;
+    }
+    bool ok = parseObject(static_cast<const unsigned char*>(mapped), size, image, error);
+    munmap(mapped, size);
+    return ok;
+}
+
+AsmProgram imageToProgram(const VMImage& image) {
+    AsmProgram program;
+    for (size_t i = 0; i < image.code.size(); ++i) {
+        const VMInstr& instr = image.code[i];
+        const OpName& name = opNames[static_cast<int>(instr.op)];
+        Instr text = {i < image.labels.size() ? image.labels[i] : "", name.name, "", 0, ""};
+        if (isBranchOp(instr.op)) {
+            const std::string& label = image.labels[instr.operand];
+            text.arg = label.empty() ? "L@" + std::to_string(instr.operand) : label;
+        } else if (name.immediate) {
+            text.arg = std::to_string(instr.operand);
+        } else if (instr.op != VMOp::NOOP && instr.op != VMOp::STOP) {
+            text.arg = image.cellNames[instr.operand];
+        }
+        program.code.push_back(text);
+    }
+    for (size_t i = 0; i < image.memory.size(); ++i) {
+        program.data.push_back({image.cellNames[i], image.memory[i]});
+    }
+    return program;
+}
@@ -0,0 +1,29 @@
+#ifndef OBJECT_FILE_H
+#define OBJECT_FILE_H
+
+#include <string>
+#include "instr.h"
+#include "vm.h"
+
+// compact binary form of a compiled program (.fso), little-endian:
+//
+//   header   32 bytes: "FSOB", u16 version, u16 reserved, u32 instruction count,
+//            u32 cell count, u32 label count, u32 name bytes, u32 checksum, u32 reserved
+//   code     8 bytes per instruction: u8 VMOp, 3 bytes zero, i32 operand
+//            (cell index, immediate or instruction index, as in VMInstr)
+//   data     i32 initial value per cell
+//   labels   u32 instruction index per label
+//   names    NUL-terminated cell names, then label names, in the same order
+//
+// the checksum is 32-bit FNV-1a over everything after the header.
+
+// encode a program; false with a message if it does not decode
+bool writeObject(const AsmProgram& program, const std::string& path, std::string& error);
+
+// map and validate an object file, producing an image ready to execute
+bool loadObject(const std::string& path, VMImage& image, std::string& error);
+
+// rebuild text-form instructions from an image (names come from the image)
+AsmProgram imageToProgram(const VMImage& image);
+
+#endif
@@ -0,0 +1,544 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "optimizer.h"
+
+// ---------------------------------------------------------------------------
+// instruction classification
+// ---------------------------------------------------------------------------
+
+static bool isBranch(const std::string& op) {
+    return op.compare(0, 2, "BR") == 0;
+}
+
+// instructions whose operand names (or is) a value rather than a label
+static bool hasValueOperand(const std::string& op) {
+    return op == "READ" || op == "WRITE" || op == "LOAD" || op == "STORE" ||
+           op == "ADD" || op == "SUB" || op == "MULT" || op == "DIV";
+}
+
+// integer immediates start with a digit (or a sign)
+static bool isLiteral(const std::string& arg) {
+    return !arg.empty() && (std::isdigit(static_cast<unsigned char>(arg[0])) || arg[0] == '-');
+}
+
+// operand names a storage cell
+static bool referencesCell(const Instr& instr) {
+    return hasValueOperand(instr.op) && !isLiteral(instr.arg);
+}
+
+// instruction reads the cell it names (READ and STORE only write it)
+static bool readsCell(const Instr& instr) {
+    return referencesCell(instr) && instr.op != "READ" && instr.op != "STORE";
+}
+
+// ---------------------------------------------------------------------------
+// control flow graph
+// ---------------------------------------------------------------------------
+
+struct BasicBlock {
+    size_t begin, end;           // instruction range [begin, end)
+    std::vector<size_t> succs;   // successor block indices
+};
+
+// split code into basic blocks: leaders are the first instruction, labelled instructions
+// and anything following a branch or STOP
+static std::vector<BasicBlock> buildBlocks(const std::vector<Instr>& code) {
+    std::vector<BasicBlock> blocks;
+    std::vector<size_t> blockOf(code.size(), 0);
+    for (size_t i = 0; i < code.size(); ++i) {
+        bool leader = i == 0 || !code[i].label.empty() ||
+                      isBranch(code[i - 1].op) || code[i - 1].op == "STOP";
+        if (leader) {
+            if (!blocks.empty()) blocks.back().end = i;
+            blocks.push_back({i, code.size(), {}});
+        }
+        blockOf[i] = blocks.size() - 1;
+    }
+
+    std::unordered_map<std::string, size_t> labelBlock;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].label.empty()) labelBlock[code[i].label] = blockOf[i];
+    }
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const Instr& last = code[blocks[b].end - 1];
+        if (isBranch(last.op)) {
+            auto target = labelBlock.find(last.arg);
+            if (target != labelBlock.end()) blocks[b].succs.push_back(target->second);
+        }
+        bool fallsThrough = last.op != "STOP" && last.op != "BR";
+        if (fallsThrough && b + 1 < blocks.size()) blocks[b].succs.push_back(b + 1);
+    }
+    return blocks;
+}
+
+// ---------------------------------------------------------------------------
+// dead store elimination
+// ---------------------------------------------------------------------------
+
+// instruction reads the accumulator (a STORE, arithmetic, or a conditional test)
+static bool readsAcc(const std::string& op) {
+    return op == "STORE" || op == "ADD" || op == "SUB" || op == "MULT" || op == "DIV" ||
+           (isBranch(op) && op != "BR");
+}
+
+// instruction overwrites the accumulator
+static bool writesAcc(const std::string& op) {
+    return op == "LOAD" || op == "ADD" || op == "SUB" || op == "MULT" || op == "DIV";
+}
+
+// one round of liveness over the cells and the accumulator: marks STOREs to dead cells and
+// pure accumulator computations (LOAD/ADD/SUB/MULT) whose result is never used;
+// DIV is kept since it can trap on a zero divisor
+static int deadStoreRound(std::vector<Instr>& code) {
+    std::vector<BasicBlock> blocks = buildBlocks(code);
+
+    // number every cell, noting which are touched by more than one block or read before
+    // being written in their block (a loop body reads the previous iteration's value);
+    // only those need the global dataflow, the rest (mostly temps) are block local.
+    // bit 0 of the global sets is the accumulator.
+    const size_t LOCAL = SIZE_MAX;
+    const size_t ACC = 0;
+    std::unordered_map<std::string, size_t> cellIndex;
+    std::vector<size_t> homeBlock;    // first block referencing the cell
+    std::vector<size_t> globalIndex;  // bit position for cells live across blocks
+    std::vector<size_t> globalCells;  // cell index for each bit position
+    size_t globals = 1;
+    globalCells.push_back(LOCAL);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            if (!referencesCell(code[i])) continue;
+            auto inserted = cellIndex.insert({code[i].arg, homeBlock.size()});
+            if (inserted.second) {
+                homeBlock.push_back(b);
+                globalIndex.push_back(LOCAL);
+                if (readsCell(code[i])) {
+                    globalIndex.back() = globals++;
+                    globalCells.push_back(inserted.first->second);
+                }
+            } else {
+                size_t c = inserted.first->second;
+                if (homeBlock[c] != b && globalIndex[c] == LOCAL) {
+                    globalIndex[c] = globals++;
+                    globalCells.push_back(c);
+                }
+            }
+        }
+    }
+
+    // per block use/def sets over the global cells, then backward liveness to a fixed point
+    const size_t words = (globals + 63) / 64;
+    typedef std::vector<uint64_t> Bits;
+    std::vector<Bits> use(blocks.size(), Bits(words, 0)), def(blocks.size(), Bits(words, 0));
+    std::vector<Bits> liveIn(blocks.size(), Bits(words, 0)), liveOut(blocks.size(), Bits(words, 0));
+    auto touch = [&](size_t b, size_t g, bool isUse) {
+        uint64_t bit = 1ULL << (g % 64);
+        if (isUse) {
+            if (!(def[b][g / 64] & bit)) use[b][g / 64] |= bit;
+        } else {
+            def[b][g / 64] |= bit;
+        }
+    };
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            if (readsAcc(code[i].op)) touch(b, ACC, true);
+            if (referencesCell(code[i])) {
+                size_t g = globalIndex[cellIndex[code[i].arg]];
+                if (g != LOCAL) touch(b, g, readsCell(code[i]));
+            }
+            if (writesAcc(code[i].op)) touch(b, ACC, false);
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = blocks.size(); b-- > 0;) {
+            for (size_t s : blocks[b].succs) {
+                for (size_t w = 0; w < words; ++w) liveOut[b][w] |= liveIn[s][w];
+            }
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t in = use[b][w] | (liveOut[b][w] & ~def[b][w]);
+                if (in != liveIn[b][w]) {
+                    liveIn[b][w] = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // walk each block backwards marking dead stores and dead accumulator results
+    std::vector<size_t> liveStamp(homeBlock.size(), 0);
+    int removed = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        size_t stamp = b + 1;
+        for (size_t g = 1; g < globals; ++g) {
+            if ((liveOut[b][g / 64] >> (g % 64)) & 1) liveStamp[globalCells[g]] = stamp;
+        }
+        bool accLive = liveOut[b][0] & 1;
+        for (size_t i = blocks[b].end; i-- > blocks[b].begin;) {
+            Instr& instr = code[i];
+            bool dead = false;
+            if (instr.op == "STORE") dead = liveStamp[cellIndex[instr.arg]] != stamp;
+            else if (writesAcc(instr.op) && instr.op != "DIV") dead = !accLive;
+            if (dead) {
+                // a labelled instruction becomes a NOOP so the branch target survives
+                if (instr.label.empty()) instr.op.clear();
+                else instr = {instr.label, "NOOP", "", instr.line, instr.kind};
+                removed++;
+                continue;
+            }
+            if (writesAcc(instr.op)) accLive = false;
+            if (readsAcc(instr.op)) accLive = true;
+            if (referencesCell(instr)) {
+                liveStamp[cellIndex[instr.arg]] = readsCell(instr) ? stamp : 0;
+            }
+        }
+    }
+
+    if (removed > 0) {
+        std::vector<Instr> kept;
+        kept.reserve(code.size());
+        for (auto& instr : code) {
+            if (!instr.op.empty()) kept.push_back(instr);
+        }
+        code.swap(kept);
+    }
+    return removed;
+}
+
+int eliminateDeadStores(AsmProgram& program) {
+    // removing a dead computation can leave the stores feeding it dead, so repeat until stable
+    int total = 0;
+    while (!program.code.empty()) {
+        int removed = deadStoreRound(program.code);
+        if (removed == 0) break;
+        total += removed;
+    }
+    return total;
+}
+
+// ---------------------------------------------------------------------------
+// control flow simplification
+// ---------------------------------------------------------------------------
+
+// whether a conditional branch taken on op guarantees that next (tested on the same ACC) is taken too
+static bool impliesBranch(const std::string& op, const std::string& next) {
+    if (next == "BR" || op == next) return true;
+    if (op == "BRNEG") return next == "BRZNEG";
+    if (op == "BRZERO") return next == "BRZNEG" || next == "BRZPOS";
+    if (op == "BRPOS") return next == "BRZPOS";
+    return false;
+}
+
+// drop NOOPs, moving their labels onto the next real instruction; labels that end up on the
+// same instruction are merged into one and branches renamed accordingly
+static int mergeLabels(std::vector<Instr>& code) {
+    int changes = 0;
+    std::unordered_map<std::string, std::string> rename;
+    std::vector<Instr> kept;
+    kept.reserve(code.size());
+    std::string pending;
+    for (auto& instr : code) {
+        if (instr.op == "NOOP") {
+            if (!instr.label.empty()) {
+                if (pending.empty()) pending = instr.label;
+                else rename[instr.label] = pending;
+            }
+            changes++;
+            continue;
+        }
+        if (!pending.empty()) {
+            if (!instr.label.empty()) rename[instr.label] = pending;
+            instr.label = pending;
+            pending.clear();
+        }
+        kept.push_back(instr);
+    }
+    if (!pending.empty()) {
+        // trailing label with nothing after it: keep it on a NOOP
+        kept.push_back({pending, "NOOP", "", 0, ""});
+        changes--;
+    }
+    for (auto& instr : kept) {
+        if (!isBranch(instr.op)) continue;
+        auto it = rename.find(instr.arg);
+        if (it != rename.end()) instr.arg = it->second;
+    }
+    code.swap(kept);
+    return changes + static_cast<int>(rename.size());
+}
+
+// retarget branches that land on another branch which is sure to be taken
+static int threadJumps(std::vector<Instr>& code) {
+    std::unordered_map<std::string, size_t> labelIndex;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].label.empty()) labelIndex[code[i].label] = i;
+    }
+    int changes = 0;
+    for (auto& instr : code) {
+        if (!isBranch(instr.op)) continue;
+        std::string dest = instr.arg;
+        std::unordered_map<std::string, bool> seen;
+        bool cycle = false;
+        while (true) {
+            seen[dest] = true;
+            auto it = labelIndex.find(dest);
+            if (it == labelIndex.end()) break;
+            const Instr& target = code[it->second];
+            if (!isBranch(target.op) || !impliesBranch(instr.op, target.op)) break;
+            if (seen.count(target.arg)) {
+                // branches that only jump among themselves: leave them alone
+                cycle = true;
+                break;
+            }
+            dest = target.arg;
+        }
+        if (!cycle && dest != instr.arg) {
+            instr.arg = dest;
+            changes++;
+        }
+    }
+    return changes;
+}
+
+// remove branches to the instruction that follows anyway
+static int removeBranchesToNext(std::vector<Instr>& code) {
+    int changes = 0;
+    for (size_t i = 0; i + 1 < code.size(); ++i) {
+        if (isBranch(code[i].op) && code[i + 1].label == code[i].arg) {
+            if (code[i].label.empty()) code[i].op.clear();
+            else code[i] = {code[i].label, "NOOP", "", code[i].line, code[i].kind};
+            changes++;
+        }
+    }
+    if (changes > 0) {
+        std::vector<Instr> kept;
+        kept.reserve(code.size());
+        for (auto& instr : code) {
+            if (!instr.op.empty()) kept.push_back(instr);
+        }
+        code.swap(kept);
+    }
+    return changes;
+}
+
+// remove instructions no path from the entry reaches
+static int removeUnreachable(std::vector<Instr>& code) {
+    if (code.empty()) return 0;
+    std::vector<BasicBlock> blocks = buildBlocks(code);
+    std::vector<char> reached(blocks.size(), 0);
+    std::vector<size_t> work(1, 0);
+    reached[0] = 1;
+    while (!work.empty()) {
+        size_t b = work.back();
+        work.pop_back();
+        for (size_t s : blocks[b].succs) {
+            if (!reached[s]) {
+                reached[s] = 1;
+                work.push_back(s);
+            }
+        }
+    }
+    std::vector<Instr> kept;
+    kept.reserve(code.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (!reached[b]) continue;
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) kept.push_back(code[i]);
+    }
+    int changes = static_cast<int>(code.size() - kept.size());
+    code.swap(kept);
+    return changes;
+}
+
+// clear labels no branch refers to
+static int removeUnusedLabels(std::vector<Instr>& code) {
+    std::unordered_map<std::string, bool> targeted;
+    for (const auto& instr : code) {
+        if (isBranch(instr.op)) targeted[instr.arg] = true;
+    }
+    int changes = 0;
+    for (auto& instr : code) {
+        if (!instr.label.empty() && !targeted.count(instr.label)) {
+            instr.label.clear();
+            changes++;
+        }
+    }
+    return changes;
+}
+
+int simplifyControlFlow(AsmProgram& program) {
+    int total = 0;
+    while (true) {
+        int changes = mergeLabels(program.code);
+        changes += threadJumps(program.code);
+        changes += removeBranchesToNext(program.code);
+        changes += removeUnreachable(program.code);
+        changes += removeUnusedLabels(program.code);
+        if (changes == 0) break;
+        total += changes;
+    }
+    return total;
+}
+
+// ---------------------------------------------------------------------------
+// accumulator content tracking
+// ---------------------------------------------------------------------------
+
+// what the accumulator is known to hold at a program point
+struct AccState {
+    bool reached = false;            // some path reaches this point
+    std::vector<std::string> cells;  // cells whose stored value equals ACC (sorted)
+    bool hasConstant = false;        // ACC holds a known immediate
+    std::string constant;
+
+    bool operator==(const AccState& other) const {
+        return reached == other.reached && cells == other.cells &&
+               hasConstant == other.hasConstant && constant == other.constant;
+    }
+    bool operator!=(const AccState& other) const { return !(*this == other); }
+
+    bool holds(const std::string& cell) const {
+        return std::binary_search(cells.begin(), cells.end(), cell);
+    }
+    void add(const std::string& cell) {
+        auto it = std::lower_bound(cells.begin(), cells.end(), cell);
+        if (it == cells.end() || *it != cell) cells.insert(it, cell);
+    }
+    void forget(const std::string& cell) {
+        auto it = std::lower_bound(cells.begin(), cells.end(), cell);
+        if (it != cells.end() && *it == cell) cells.erase(it);
+    }
+    void clear() {
+        cells.clear();
+        hasConstant = false;
+        constant.clear();
+    }
+};
+
+// state where two paths join: only what both agree on survives
+static AccState meet(const AccState& a, const AccState& b) {
+    if (!a.reached) return b;
+    if (!b.reached) return a;
+    AccState joined;
+    joined.reached = true;
+    std::set_intersection(a.cells.begin(), a.cells.end(), b.cells.begin(), b.cells.end(),
+                          std::back_inserter(joined.cells));
+    if (a.hasConstant && b.hasConstant && a.constant == b.constant) {
+        joined.hasConstant = true;
+        joined.constant = a.constant;
+    }
+    return joined;
+}
+
+// whether instr leaves memory and ACC as they already are under state
+static bool isRedundant(const Instr& instr, const AccState& state) {
+    if (instr.op == "LOAD") {
+        if (isLiteral(instr.arg)) return state.hasConstant && state.constant == instr.arg;
+        return state.holds(instr.arg);
+    }
+    return instr.op == "STORE" && state.holds(instr.arg);
+}
+
+// effect of one instruction on what ACC holds
+static void transfer(const Instr& instr, AccState& state) {
+    const std::string& op = instr.op;
+    if (op == "LOAD") {
+        state.clear();
+        if (isLiteral(instr.arg)) {
+            state.hasConstant = true;
+            state.constant = instr.arg;
+        } else {
+            state.add(instr.arg);
+        }
+    } else if (op == "STORE") {
+        state.add(instr.arg);
+    } else if (op == "READ") {
+        state.forget(instr.arg);
+    } else if (writesAcc(op)) {
+        state.clear();
+    }
+}
+
+int eliminateRedundantLoads(AsmProgram& program, int* storesRemoved) {
+    std::vector<Instr>& code = program.code;
+    if (storesRemoved) *storesRemoved = 0;
+    if (code.empty()) return 0;
+    std::vector<BasicBlock> blocks = buildBlocks(code);
+    std::vector<std::vector<size_t>> preds(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t s : blocks[b].succs) preds[s].push_back(b);
+    }
+
+    // forward dataflow: a block starts with what all of its predecessors agree on
+    std::vector<AccState> in(blocks.size()), out(blocks.size());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            AccState state;
+            if (b == 0) state.reached = true; // nothing is known on entry
+            else for (size_t p : preds[b]) state = meet(state, out[p]);
+            in[b] = state;
+            if (state.reached) {
+                for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) transfer(code[i], state);
+            }
+            if (state != out[b]) {
+                out[b] = state;
+                changed = true;
+            }
+        }
+    }
+
+    // drop loads of values already in ACC and stores of values already in memory
+    int loads = 0, stores = 0;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        AccState state = in[b];
+        if (!state.reached) continue;
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            Instr& instr = code[i];
+            if (isRedundant(instr, state)) {
+                if (instr.op == "LOAD") loads++;
+                else stores++;
+                // a labelled instruction becomes a NOOP so the branch target survives
+                if (instr.label.empty()) instr.op.clear();
+                else instr = {instr.label, "NOOP", "", instr.line, instr.kind};
+                continue;
+            }
+            transfer(instr, state);
+        }
+    }
+    if (loads + stores > 0) {
+        std::vector<Instr> kept;
+        kept.reserve(code.size());
+        for (auto& instr : code) {
+            if (!instr.op.empty()) kept.push_back(instr);
+        }
+        code.swap(kept);
+    }
+    if (storesRemoved) *storesRemoved = stores;
+    return loads;
+}
+
+// ---------------------------------------------------------------------------
+// unused storage
+// ---------------------------------------------------------------------------
+
+int removeUnusedStorage(AsmProgram& program) {
+    std::unordered_map<std::string, bool> referenced;
+    for (const auto& instr : program.code) {
+        if (referencesCell(instr)) referenced[instr.arg] = true;
+    }
+    std::vector<DataCell> kept;
+    for (const auto& cell : program.data) {
+        if (referenced.count(cell.name)) kept.push_back(cell);
+    }
+    int removed = static_cast<int>(program.data.size() - kept.size());
+    program.data.swap(kept);
+    return removed;
+}
@@ -0,0 +1,24 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "instr.h"
+
+// passes over generated accumulator code; each returns the number of instructions or cells it removed
+
+// remove STOREs whose value is overwritten or never read afterwards (liveness based),
+// along with the accumulator computations that only fed them
+int eliminateDeadStores(AsmProgram& program);
+
+// thread jumps through branches, fold NOOP-only blocks and equivalent labels into one,
+// and remove unreachable code, branches to the next instruction and labels nothing targets
+int simplifyControlFlow(AsmProgram& program);
+
+// track what the accumulator holds (cells and immediates) across instructions and, where all
+// predecessors agree, across block boundaries; drop LOADs of values already in ACC and STOREs
+// of values already in memory. returns the LOADs removed, storesRemoved gets the STOREs.
+int eliminateRedundantLoads(AsmProgram& program, int* storesRemoved = nullptr);
+
+// remove data cells no remaining instruction refers to
+int removeUnusedStorage(AsmProgram& program);
+
+#endif
@@ -7,18 +7,20 @@
 
 /*
 BNF Grammar:
-<program>  ->     go <vars> <block> exit
+<program>  ->     go <vars> <funcs> <block> exit
+<funcs>        ->      empty | func identifier <block> <funcs>          parameterless subroutines
 <vars>         ->      empty | int identifier = integer <varList> :
 <varList>     ->      identifier = integer <varList> | empty
 <block>       ->      { <vars> <stats> }
 <stats>         ->      <stat> <mStat>
 <mStat>       ->      empty |  <stat> <mStat>
-<stat>           ->      <read>   | <print>   | <block> | <cond>  | <loop>  | <assign>
+<stat>           ->      <read>   | <print>   | <block> | <cond>  | <loop>  | <assign> | <call>
 <read>         ->      scan identifier :
 <print>        ->     output <exp> :
 <cond>        ->     cond [ identifier <relational> <exp> ] <stat>
 <loop>         ->     loop [ identifier <relational> <exp> ]  <stat>
 <assign>      ->     set identifier = <exp> :
+<call>          ->     func identifier :
 <relational> ->      ?le  | ?ge | ?lt | ?eq | ?ne | ?gt | ; | = =    added ?ne and ?gt to match scanner lexical definitions from P1                  
 <exp>          ->      <M> ** <exp> | <M> // <exp> | <M>
 <M>             ->      <N> + <M> | <N>      
@@ -44,12 +46,17 @@ Node* program() {
     // do not store the "go" keyword as a token; node->type already identifies the node
     if (tk.group == TokenGroup::KEYWORD && tk.instance == "go") {
         root->type = "program";
+        root->kind = NodeKind::Program;
         tk = scanner();
     } else {
         std::cerr << "Syntax Error: Expected 'go' at line " << tk.line << std::endl;
         exit(1);
     }
     root->children.push_back(vars());
+    // subroutine definitions sit between the globals and the main block
+    while (tk.group == TokenGroup::KEYWORD && tk.instance == "func") {
+        root->children.push_back(funcDef());
+    }
     root->children.push_back(block());
     // do not store the "exit" keyword as a token
     if (tk.group == TokenGroup::KEYWORD && tk.instance == "exit") {
@@ -64,6 +71,7 @@ Node* program() {
 Node* vars() {
     Node* root = new Node();
     root->type = "vars";
+    root->kind = NodeKind::Vars;
     if (tk.group == TokenGroup::KEYWORD && tk.instance == "int") {
         // consume 'int' keyword but do not store it in tokens
         tk = scanner();
@@ -109,6 +117,7 @@ Node* vars() {
 Node* varList() {
     Node* root = new Node();
     root->type = "varList";
+    root->kind = NodeKind::VarList;
     if (tk.group == TokenGroup::IDENTIFIER) {
         // identifier = integer <varList> | empty
         root->tokens.push_back(tk.instance);
@@ -141,6 +150,7 @@ Node* block() {
     Node* root = new Node();
     if (tk.group == TokenGroup::DELIMITER && tk.instance == "{") {
         root->type = "block";
+        root->kind = NodeKind::Block;
         root->tokens.push_back(tk.instance);
         root->line_numbers.push_back(tk.line);
         tk = scanner();
@@ -164,6 +174,7 @@ Node* block() {
 Node* stats() {;
     Node* root = new Node();
     root->type = "stats";
+    root->kind = NodeKind::Stats;
     root->children.push_back(stat());
     root->children.push_back(mStat());
     return root;
@@ -172,6 +183,7 @@ Node* stats() {;
 Node* mStat() {
     Node* root = new Node();
     root->type = "mStat";
+    root->kind = NodeKind::MStat;
     if (tk.group == TokenGroup::KEYWORD || (tk.group == TokenGroup::DELIMITER && tk.instance == "{")) {
         root->children.push_back(stat());
         root->children.push_back(mStat());
@@ -184,6 +196,7 @@ Node* mStat() {
 Node* stat() {
     Node* root = new Node();
     root->type = "stat";
+    root->kind = NodeKind::Stat;
     if (tk.group == TokenGroup::KEYWORD && tk.instance == "scan") {
         root->children.push_back(read());
     } else if (tk.group == TokenGroup::KEYWORD && tk.instance == "output") {
@@ -196,6 +209,8 @@ Node* stat() {
         root->children.push_back(loop());
     } else if (tk.group == TokenGroup::KEYWORD && tk.instance == "set") {
         root->children.push_back(assign());
+    } else if (tk.group == TokenGroup::KEYWORD && tk.instance == "func") {
+        root->children.push_back(call());
     } else {
         std::cerr << "Syntax Error: Invalid statement at line " << tk.line << std::endl;
         exit(1);
@@ -206,6 +221,7 @@ Node* stat() {
 Node* read() {
     Node* root = new Node();
     root->type = "read";
+    root->kind = NodeKind::Read;
     // consume 'scan' keyword but do not store it as a token
     if (tk.group == TokenGroup::KEYWORD && tk.instance == "scan") {
         tk = scanner();
@@ -235,6 +251,7 @@ Node* read() {
 Node* print() {
     Node* root = new Node();
     root->type = "print";
+    root->kind = NodeKind::Print;
     tk = scanner();
     root->children.push_back(exp());
     if (tk.group == TokenGroup::DELIMITER && tk.instance == ":") {
@@ -250,6 +267,7 @@ Node* cond() {
     Node* root = new Node();
     tk = scanner();
     root->type = "cond";
+    root->kind = NodeKind::Cond;
     if (tk.group == TokenGroup::DELIMITER && tk.instance == "[") {
         root->tokens.push_back(tk.instance);
         root->line_numbers.push_back(tk.line);
@@ -284,6 +302,7 @@ Node* loop() {
     Node* root = new Node();
     tk = scanner();
     root->type = "loop";
+    root->kind = NodeKind::Loop;
     if (tk.group == TokenGroup::DELIMITER && tk.instance == "[") {
         root->tokens.push_back(tk.instance);
         root->line_numbers.push_back(tk.line);
@@ -317,6 +336,7 @@ Node* loop() {
 Node* assign() {
     Node* root = new Node();
     root->type = "assign";
+    root->kind = NodeKind::Assign;
     // assume tk is 'set'
     if (tk.group == TokenGroup::KEYWORD && tk.instance == "set") {
         tk = scanner();
@@ -351,9 +371,49 @@ Node* assign() {
     return root;
 }
 
+Node* funcDef() {
+    Node* root = new Node();
+    root->type = "func";
+    root->kind = NodeKind::Func;
+    tk = scanner(); // consume 'func'
+    if (tk.group == TokenGroup::IDENTIFIER) {
+        root->tokens.push_back(tk.instance);
+        root->line_numbers.push_back(tk.line);
+        tk = scanner();
+    } else {
+        std::cerr << "Syntax Error: Expected subroutine name after 'func' at line " << tk.line << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    root->children.push_back(block());
+    return root;
+}
+
+Node* call() {
+    Node* root = new Node();
+    root->type = "call";
+    root->kind = NodeKind::Call;
+    tk = scanner(); // consume 'func'
+    if (tk.group == TokenGroup::IDENTIFIER) {
+        root->tokens.push_back(tk.instance);
+        root->line_numbers.push_back(tk.line);
+        tk = scanner();
+    } else {
+        std::cerr << "Syntax Error: Expected subroutine name after 'func' at line " << tk.line << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (tk.group == TokenGroup::DELIMITER && tk.instance == ":") {
+        tk = scanner();
+    } else {
+        std::cerr << "Syntax Error: Expected ':' after subroutine call at line " << tk.line << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return root;
+}
+
 Node* relational() {
     Node* root = new Node();
     root->type = "relational";
+    root->kind = NodeKind::Relational;
     if (tk.group == TokenGroup::OPERATOR &&
         (tk.instance == "?le" || tk.instance == "?ge" || tk.instance == "?lt" ||
          tk.instance == "?eq" || tk.instance == "?ne" || tk.instance == "?gt" || tk.instance == ";" || tk.instance == "= =")) { // added ?ne and ?gt to match scanner lexical definitions from P1
@@ -370,6 +430,7 @@ Node* relational() {
 Node* exp() {
     Node* root = new Node();
     root->type = "exp";
+    root->kind = NodeKind::Exp;
     root->children.push_back(M());
     if (tk.group == TokenGroup::OPERATOR && (tk.instance == "**" || tk.instance == "//")) {
         root->tokens.push_back(tk.instance);
@@ -383,6 +444,7 @@ Node* exp() {
 Node* M() {
     Node* root = new Node();
     root->type = "M";
+    root->kind = NodeKind::M;
     root->children.push_back(N());
     if (tk.group == TokenGroup::OPERATOR && tk.instance == "+") {
         root->tokens.push_back(tk.instance);
@@ -396,6 +458,7 @@ Node* M() {
 Node* N() {
     Node* root = new Node();
     root->type = "N";
+    root->kind = NodeKind::N;
     if (tk.group == TokenGroup::OPERATOR && tk.instance == "-") {
         root->tokens.push_back(tk.instance);
         root->line_numbers.push_back(tk.line);
@@ -416,6 +479,7 @@ Node* N() {
 Node* R() {
     Node* root = new Node();
     root->type = "R";
+    root->kind = NodeKind::R;
     if (tk.group == TokenGroup::DELIMITER && tk.instance == "(") {
         root->tokens.push_back(tk.instance);
         root->line_numbers.push_back(tk.line);
@@ -471,3 +535,8 @@ void testTree(Node* node, int depth) {
     for (auto *ch : node->children) testTree(ch, depth + 1);
 }
 
+void freeTree(Node* root) {
+    if (!root) return;
+    for (Node* child : root->children) freeTree(child);
+    delete root;
+}
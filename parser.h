@@ -8,9 +8,16 @@
 // global token used by the parser (defined in parser.cpp)
 extern Token tk;
 
-// parser entry point
+// parser entry point, over the tokens of the last initScanner
 Node* parser();
 
+// scan source, then parse it
+template <class Source>
+Node* parser(Source& source) {
+    initScanner(source);
+    return parser();
+}
+
 // grammar parsing functions
 Node* program();
 Node* vars();
@@ -25,6 +32,8 @@ Node* print();
 Node* cond();
 Node* loop();
 Node* assign();
+Node* funcDef();
+Node* call();
 
 Node* relational();
 
@@ -35,4 +44,7 @@ Node* R();
 
 void testTree(Node* root, int depth = 0);
 
+// release a tree built by parser()
+void freeTree(Node* root);
+
 #endif // PARSER_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "passManager.h"
+#include "optimizer.h"
+#include "timing.h"
+
+static int redundantLoads(AsmProgram& program) {
+    int stores = 0;
+    int loads = eliminateRedundantLoads(program, &stores);
+    return loads + stores;
+}
+
+// labels are unique, every branch has a target and STOP ends the code; a broken
+// pipeline stops the compile here rather than producing code that will not load
+static int verifyCode(AsmProgram& program) {
+    std::set<std::string> labels;
+    for (const auto& instr : program.code) {
+        if (!instr.label.empty() && !labels.insert(instr.label).second) {
+            std::cerr << "INTERNAL ERROR: duplicate label " << instr.label << std::endl;
+            std::exit(1);
+        }
+    }
+    for (const auto& instr : program.code) {
+        bool branch = instr.op.compare(0, 2, "BR") == 0;
+        if (branch && !labels.count(instr.arg)) {
+            std::cerr << "INTERNAL ERROR: branch to undefined label " << instr.arg << std::endl;
+            std::exit(1);
+        }
+    }
+    if (program.code.empty() || program.code.back().op != "STOP") {
+        std::cerr << "INTERNAL ERROR: code does not end in STOP" << std::endl;
+        std::exit(1);
+    }
+    return 0;
+}
+
+const std::vector<PassInfo>& registeredPasses() {
+    static const std::vector<PassInfo> passes = {
+        {"simplify-cfg", false, "thread jumps, drop unreachable code, empty blocks and unused labels",
+         simplifyControlFlow},
+        {"redundant-loads", false, "drop loads of values already in ACC and stores of values already in memory",
+         redundantLoads},
+        {"dead-stores", false, "drop stores never read and the computations that only fed them",
+         eliminateDeadStores},
+        {"unused-storage", false, "drop data cells no instruction refers to", removeUnusedStorage},
+        {"verify", true, "check labels, branch targets and the final STOP", verifyCode},
+    };
+    return passes;
+}
+
+static const PassInfo* findPass(const std::string& name) {
+    for (const auto& pass : registeredPasses()) {
+        if (name == pass.name) return &pass;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> pipelineForLevel(int level) {
+    if (level <= 0) return {};
+    if (level == 1) return {"simplify-cfg", "dead-stores", "unused-storage"};
+    return {"simplify-cfg", "redundant-loads", "dead-stores", "unused-storage", "simplify-cfg"};
+}
+
+int unrollBudgetForLevel(int level) {
+    return level >= 2 ? 64 : 0;
+}
+
+int inlineBudgetForLevel(int level) {
+    if (level <= 0) return -1;
+    return level == 1 ? 0 : 16;
+}
+
+bool parsePassList(const std::string& list, std::vector<std::string>& passes, std::string& error) {
+    passes.clear();
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ',')) {
+        if (name.empty()) continue;
+        if (!findPass(name)) {
+            error = "unknown pass '" + name + "'; available:";
+            for (const auto& pass : registeredPasses()) error += std::string(" ") + pass.name;
+            return false;
+        }
+        passes.push_back(name);
+    }
+    return true;
+}
+
+std::vector<PassResult> runPasses(AsmProgram& program, const std::vector<std::string>& pipeline) {
+    typedef std::chrono::steady_clock Clock;
+    std::vector<PassResult> results;
+    for (const auto& name : pipeline) {
+        const PassInfo* pass = findPass(name);
+        if (!pass) continue;
+        PhaseScope phase(pass->name);
+        PassResult result;
+        result.name = name;
+        result.instructionsBefore = static_cast<int>(program.code.size());
+        auto start = Clock::now();
+        result.changes = pass->run(program);
+        result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        result.instructionsAfter = static_cast<int>(program.code.size());
+        results.push_back(result);
+    }
+    return results;
+}
+
+void printPassResults(const std::vector<PassResult>& results, std::ostream& out) {
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::left << std::setw(18) << "pass" << std::right << std::setw(10) << "ms" << std::setw(9) << "changes"
+        << std::setw(14) << "instructions" << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& r : results) {
+        out << std::left << std::setw(18) << r.name << std::right << std::setw(10) << r.ms << std::setw(9)
+            << r.changes << std::setw(7) << r.instructionsBefore << " -> " << r.instructionsAfter << "\n";
+    }
+    out.flags(flags);
+}
@@ -0,0 +1,49 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "instr.h"
+
+// registered passes over generated code and the -O pipelines built from them
+
+// an analysis (changes nothing, may reject the program) or a transform; run returns
+// the number of changes made
+struct PassInfo {
+    const char* name;
+    bool analysis;
+    const char* description;
+    int (*run)(AsmProgram& program);
+};
+
+// what one pass did in one run
+struct PassResult {
+    std::string name;
+    double ms;
+    int changes;
+    int instructionsBefore;
+    int instructionsAfter;
+};
+
+const std::vector<PassInfo>& registeredPasses();
+
+// pass names making up -O0, -O1 or -O2 (levels above 2 use -O2)
+std::vector<std::string> pipelineForLevel(int level);
+
+// loop unroll budget each -O level uses unless --unroll-budget overrides it
+int unrollBudgetForLevel(int level);
+
+// subroutine inline budget each -O level uses unless --inline-budget overrides it
+int inlineBudgetForLevel(int level);
+
+// split a comma separated --passes list; false with a message naming an unknown pass
+bool parsePassList(const std::string& list, std::vector<std::string>& passes, std::string& error);
+
+// run the passes in order, timing each one
+std::vector<PassResult> runPasses(AsmProgram& program, const std::vector<std::string>& pipeline);
+
+// one line per pass: time, changes and instruction count before and after
+void printPassResults(const std::vector<PassResult>& results, std::ostream& out);
+
+#endif
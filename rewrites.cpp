@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "rewrites.h"
+
+static bool isOperator(const std::string& word) {
+    return word == "**" || word == "//" || word == "+" || word == "-";
+}
+
+static void skipSpaces(const std::string& text, size_t& pos) {
+    while (pos < text.size() && text[pos] == ' ') pos++;
+}
+
+static bool parseShapeAt(const std::string& text, size_t& pos, Shape& shape, std::string& error) {
+    skipSpaces(text, pos);
+    if (pos >= text.size()) {
+        error = "shape ends early";
+        return false;
+    }
+    if (text[pos] != '(') {
+        char operand = text[pos++];
+        if ((operand < 'a' || operand > 'd') && operand != 'e') {
+            error = std::string("unknown operand ") + operand;
+            return false;
+        }
+        shape.operand = operand;
+        return true;
+    }
+    size_t start = ++pos;
+    while (pos < text.size() && text[pos] != ' ' && text[pos] != ')') pos++;
+    shape.op = text.substr(start, pos - start);
+    if (!isOperator(shape.op)) {
+        error = "unknown operator " + shape.op;
+        return false;
+    }
+    while (true) {
+        skipSpaces(text, pos);
+        if (pos < text.size() && text[pos] == ')') break;
+        shape.children.emplace_back();
+        if (!parseShapeAt(text, pos, shape.children.back(), error)) return false;
+    }
+    pos++;
+    size_t arity = shape.children.size();
+    if (arity != 2 && !(arity == 1 && shape.op == "-")) {
+        error = "wrong number of operands for " + shape.op;
+        return false;
+    }
+    return true;
+}
+
+bool parseShape(const std::string& text, Shape& shape, std::string& error) {
+    shape = Shape();
+    size_t pos = 0;
+    if (!parseShapeAt(text, pos, shape, error)) return false;
+    skipSpaces(text, pos);
+    if (pos != text.size()) {
+        error = "text after shape";
+        return false;
+    }
+    return true;
+}
+
+std::string shapeText(const Shape& shape) {
+    if (shape.op.empty()) return std::string(1, shape.operand);
+    std::string text = "(" + shape.op;
+    for (const auto& child : shape.children) text += " " + shapeText(child);
+    return text + ")";
+}
+
+// genExp/genM/genN: right operand, STORE t, left operand, op t; negation is the
+// operand, STORE t, LOAD 0, SUB t
+int templateLength(const Shape& shape) {
+    if (shape.op.empty()) return shape.operand == 'e' ? 0 : 1;
+    if (shape.children.size() == 1) return templateLength(shape.children[0]) + 3;
+    return templateLength(shape.children[0]) + templateLength(shape.children[1]) + 2;
+}
+
+static bool parseCode(const std::string& text, std::vector<RewriteStep>& code, std::string& error) {
+    std::istringstream steps(text);
+    std::string step;
+    while (std::getline(steps, step, ';')) {
+        std::istringstream words(step);
+        RewriteStep parsed;
+        std::string extra;
+        if (!(words >> parsed.op >> parsed.arg) || (words >> extra)) {
+            error = "bad instruction '" + step + "'";
+            return false;
+        }
+        if (parsed.op != "LOAD" && parsed.op != "STORE" && parsed.op != "ADD" && parsed.op != "SUB" &&
+            parsed.op != "MULT" && parsed.op != "DIV" && parsed.op != "EVAL") {
+            error = "unknown instruction " + parsed.op;
+            return false;
+        }
+        code.push_back(parsed);
+    }
+    if (code.empty()) {
+        error = "no instructions";
+        return false;
+    }
+    return true;
+}
+
+static void operandsOf(const Shape& shape, std::string& operands) {
+    if (shape.op.empty()) operands += shape.operand;
+    for (const auto& child : shape.children) operandsOf(child, operands);
+}
+
+// every operand the code names is one of the shape's leaves, a temp or an immediate, and
+// the code computes e exactly once if the shape has one
+static bool checkRule(const RewriteRule& rule, std::string& error) {
+    std::string operands;
+    operandsOf(rule.shape, operands);
+    if (std::count(operands.begin(), operands.end(), 'e') > 1) {
+        error = "more than one e";
+        return false;
+    }
+    size_t evals = 0;
+    for (const auto& step : rule.code) {
+        const std::string& arg = step.arg;
+        bool ok;
+        if (step.op == "EVAL") {
+            evals++;
+            ok = arg == "e";
+        } else if (step.op == "STORE") {
+            ok = arg == "t0" || arg == "t1";
+        } else if (arg.size() == 1 && arg[0] >= 'a' && arg[0] <= 'd') {
+            ok = operands.find(arg[0]) != std::string::npos;
+        } else {
+            ok = arg == "t0" || arg == "t1" || arg.find_first_not_of("0123456789") == std::string::npos;
+        }
+        if (!ok) {
+            error = "bad operand " + arg + " for " + step.op;
+            return false;
+        }
+    }
+    if (evals != (operands.find('e') != std::string::npos ? 1u : 0u)) {
+        error = "e must be computed exactly once";
+        return false;
+    }
+    return true;
+}
+
+bool readRewrites(const std::string& path, std::vector<RewriteRule>& rules, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "could not open " + path;
+        return false;
+    }
+    return readRewrites(in, path, rules, error);
+}
+
+bool readRewrites(std::istream& in, const std::string& name, std::vector<RewriteRule>& rules, std::string& error) {
+    std::string line;
+    int number = 0;
+    while (std::getline(in, line)) {
+        number++;
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string shape, length, code;
+        RewriteRule rule;
+        std::string problem;
+        if (!std::getline(fields, shape, '\t') || !std::getline(fields, length, '\t') ||
+            !std::getline(fields, code)) {
+            problem = "expected shape, template length and instructions";
+        } else if (parseShape(shape, rule.shape, problem) && parseCode(code, rule.code, problem) &&
+                   checkRule(rule, problem)) {
+            rule.templateLength = std::atoi(length.c_str());
+        }
+        if (!problem.empty()) {
+            error = name + ":" + std::to_string(number) + ": " + problem;
+            return false;
+        }
+        rules.push_back(rule);
+    }
+    return true;
+}
+
+// rewrites.txt as of the build, one string literal per line (see the Makefile)
+static const char BUILTIN_REWRITES[] =
+#include "rewriteTable.inc"
+    "";
+
+static std::vector<RewriteRule> parseBuiltinRewrites() {
+    std::istringstream in(BUILTIN_REWRITES);
+    std::vector<RewriteRule> rules;
+    std::string error;
+    if (!readRewrites(in, "rewrites.txt (built in)", rules, error)) {
+        std::cerr << "Bad built-in rewrite table: " << error << std::endl;
+        std::exit(1);
+    }
+    return rules;
+}
+
+const std::vector<RewriteRule>& builtinRewrites() {
+    static const std::vector<RewriteRule> rules = parseBuiltinRewrites();
+    return rules;
+}
+
+void writeRewrites(const std::vector<RewriteRule>& rules, std::ostream& out) {
+    out << "# shape\ttemplate-length\tinstructions\n";
+    for (const auto& rule : rules) {
+        out << shapeText(rule.shape) << "\t" << rule.templateLength << "\t";
+        for (size_t i = 0; i < rule.code.size(); ++i) {
+            out << (i ? "; " : "") << rule.code[i].op << " " << rule.code[i].arg;
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef REWRITES_H
+#define REWRITES_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// rewrite table for expression code: for small expression shapes, the shortest instruction
+// sequence tools/superopt found that computes the same value (and traps on the same zero
+// divisors) as the spill-right-then-compute template in genExp/genM/genN. one rule per line:
+//
+//   shape <tab> template-length <tab> instructions
+//   (// a (+ b c))	7	LOAD b; ADD c; STORE t0; LOAD a; DIV t0
+//
+// shapes are written in the source's operators, ** // + and - (one child: negation).
+// operands a b c d stand for leaves (an identifier or an integer) and e for any other
+// expression, whose code the rule places where it says EVAL e. t0 and t1 are fresh temps;
+// other operands are immediates.
+
+struct Shape {
+    std::string op;                 // empty for an operand
+    char operand = 0;               // 'a'..'d' a leaf, 'e' any expression
+    std::vector<Shape> children;
+};
+
+struct RewriteStep {
+    std::string op;                 // LOAD STORE ADD SUB MULT DIV, or EVAL
+    std::string arg;
+};
+
+struct RewriteRule {
+    Shape shape;
+    int templateLength = 0;         // instructions the template emits, not counting e's own
+    std::vector<RewriteStep> code;
+};
+
+bool parseShape(const std::string& text, Shape& shape, std::string& error);
+std::string shapeText(const Shape& shape);
+
+// instructions the template emits for a shape (e counts as none)
+int templateLength(const Shape& shape);
+
+bool readRewrites(const std::string& path, std::vector<RewriteRule>& rules, std::string& error);
+bool readRewrites(std::istream& in, const std::string& name, std::vector<RewriteRule>& rules, std::string& error);
+void writeRewrites(const std::vector<RewriteRule>& rules, std::ostream& out);
+
+// the table in rewrites.txt when the compiler was built
+const std::vector<RewriteRule>& builtinRewrites();
+
+#endif
@@ -3,10 +3,13 @@
 #include <fstream>
 #include <iostream>
 #include <cctype>
+#include <cstring>
+#include <utility>
 #include <unordered_set>
 #include <vector>
 
 static std::vector<Token> tokens;
+static size_t cursor = 0; // next token handed to the parser
 
 static const std::unordered_set<std::string> keywords = {
     "go","og","loop","int","exit","scan","output","cond","then","set","func","program"
@@ -22,165 +25,177 @@ static void lexicalError(const std::string &msg, int line) {
 }
 
 static bool isOperatorStart(char c) {
-    const std::string ops = ":;+-=(){}[]";
-    return ops.find(c) != std::string::npos || c == '?' || c == '*' || c == '/';
+    return c != '\0' && std::strchr(":;+-=(){}[]?*/", c) != nullptr;
 }
 
-void initScanner(std::istream &in) {
-    tokens.clear();
+// the text from the cursor up to n characters, stopping at the end of the line
+template <class Source>
+static std::string lineAhead(Source& source, size_t n) {
+    std::string text;
+    for (size_t k = 0; k < n && source.ensure(k + 1) && source.peek(k) != '\n'; k++) text.push_back(source.peek(k));
+    return text;
+}
 
-    std::string line;
-    int lineno = 0;
-    while (std::getline(in, line)) {
-        lineno++;
-        size_t i = 0;
-        while (i < line.size()) {
-            char c = line[i];
-
-            // Skip whitespace
-            if (std::isspace((unsigned char)c)) { i++; continue; }
-
-            if (c == '@') {
-                // consume until next @ or EOF of file; comments can span lines
-                bool closed = false;
-                // search rest of current line first
-                size_t j = i+1;
-                while (true) {
-                    // search in current line
-                    while (j < line.size()) {
-                        if (line[j] == '@') { closed = true; i = j+1; break; }
-                        j++;
-                    }
-                    if (closed) break;
-                    // not closed on this line: read next line
-                    if (!std::getline(in, line)) {
-                        lexicalError("Unterminated comment", lineno);
-                    }
-                    lineno++;
-                    j = 0;
-                }
-                continue;
+// tokens carry the line they start on; a newline ends a line, and a final line without
+// one still counts, so the EOF token sits one past the last line that has any text
+template <class Source>
+void initScanner(Source& source) {
+    tokens.clear();
+    cursor = 0;
+
+    int lineno = 1;
+    bool lineStart = true; // nothing read on the current line yet
+    while (source.ensure(1)) {
+        char c = source.peek(0);
+
+        // Skip whitespace
+        if (std::isspace((unsigned char)c)) {
+            if (c == '\n') lineno++;
+            lineStart = c == '\n';
+            source.advance(1);
+            continue;
+        }
+        lineStart = false;
+
+        if (c == '@') {
+            // consume until next @ or EOF of file; comments can span lines
+            source.advance(1);
+            while (true) {
+                if (!source.ensure(1)) lexicalError("Unterminated comment", lineStart ? lineno - 1 : lineno);
+                char d = source.peek(0);
+                source.advance(1);
+                if (d == '@') break;
+                if (d == '\n') lineno++;
+                lineStart = d == '\n';
             }
+            continue;
+        }
 
-            // Identifiers: start with letter 'x' then letters/digits/underscore, up to 8 significant
-            if (std::isalpha((unsigned char)c)) {
-                size_t j = i;
-                std::string ident;
-                while (j < line.size() && (std::isalnum((unsigned char)line[j]) || line[j] == '_')) {
-                    ident.push_back(line[j]);
-                    j++;
-                }
-                // Keywords are case-sensitive: match the identifier string exactly
-                if (keywords.count(ident)) {
-                    tokens.push_back({TokenGroup::KEYWORD, ident, lineno});
-                    i = j;
-                    continue;
-                }
-
-                // Identifiers must begin with lowercase x
-                if (ident.size() > 0 && ident[0] == 'x') {
-                    // enforce up to 8 significant characters
-                    if (ident.size() > 8) {
-                        lexicalError("Identifier too long: '" + ident + "'", lineno);
-                    }
-                    tokens.push_back({TokenGroup::IDENTIFIER, ident, lineno});
-                    i = j;
-                    continue;
+        // Identifiers: start with letter 'x' then letters/digits/underscore, up to 8 significant
+        if (std::isalpha((unsigned char)c)) {
+            std::string ident;
+            size_t j = 0;
+            while (source.ensure(j + 1) && (std::isalnum((unsigned char)source.peek(j)) || source.peek(j) == '_')) {
+                ident.push_back(source.peek(j));
+                j++;
+            }
+            source.advance(j);
+            // Identifiers must begin with lowercase x (no keyword does, so skip the lookup)
+            if (ident[0] == 'x') {
+                // enforce up to 8 significant characters
+                if (ident.size() > 8) {
+                    lexicalError("Identifier too long: '" + ident + "'", lineno);
                 }
-
-                // If it's a word that is not a keyword and not an identifier starting with x -> lexical error
-                lexicalError("Invalid identifier or keyword: '" + ident + "'", lineno);
+                tokens.push_back({TokenGroup::IDENTIFIER, std::move(ident), lineno});
+                continue;
             }
 
-            // Numbers: sequence of digits, up to 8 significant, no sign, no decimal
-            if (std::isdigit((unsigned char)c)) {
-                size_t j = i;
-                std::string num;
-                while (j < line.size() && std::isdigit((unsigned char)line[j])) {
-                    num.push_back(line[j]);
-                    j++;
-                }
-                if (num.size() > 8) lexicalError("Number too long: '" + num + "'", lineno);
-                tokens.push_back({TokenGroup::NUMBER, num, lineno});
-                i = j;
+            // Keywords are case-sensitive: match the identifier string exactly
+            if (keywords.count(ident)) {
+                tokens.push_back({TokenGroup::KEYWORD, std::move(ident), lineno});
                 continue;
             }
 
-            // Operators and punctuation
-            if (isOperatorStart(c)) {
-                // Check multi-char operators: ?xx, **, //
-                if (c == '?') {
-                    // need two more letters
-                    if (i + 2 < line.size()) {
-                        std::string op = line.substr(i, 3);
-                        if (multi_ops.count(op)) {
-                            tokens.push_back({TokenGroup::OPERATOR, op, lineno});
-                            i += 3;
-                            continue;
-                        }
-                    }
-                    lexicalError(std::string("Unknown operator starting with ? at '") + line.substr(i, std::min<size_t>(3, line.size()-i)) + "'", lineno);
-                }
+            // If it's a word that is not a keyword and not an identifier starting with x -> lexical error
+            lexicalError("Invalid identifier or keyword: '" + ident + "'", lineno);
+        }
 
-                if (c == '*') {
-                    if (i + 1 < line.size() && line[i+1] == '*') {
-                        tokens.push_back({TokenGroup::OPERATOR, "**", lineno});
-                        i += 2; continue;
-                    }
-                }
-                if (c == '/') {
-                    if (i + 1 < line.size() && line[i+1] == '/') {
-                        tokens.push_back({TokenGroup::OPERATOR, "//", lineno});
-                        i += 2; continue;
-                    }
-                }
+        // Numbers: sequence of digits, up to 8 significant, no sign, no decimal
+        if (std::isdigit((unsigned char)c)) {
+            std::string num;
+            size_t j = 0;
+            while (source.ensure(j + 1) && std::isdigit((unsigned char)source.peek(j))) {
+                num.push_back(source.peek(j));
+                j++;
+            }
+            source.advance(j);
+            if (num.size() > 8) lexicalError("Number too long: '" + num + "'", lineno);
+            tokens.push_back({TokenGroup::NUMBER, std::move(num), lineno});
+            continue;
+        }
 
-                // New: accept the spaced operator "= =" as a single operator token.
-                if (c == '=') {
-                    size_t j = i + 1;
-                    // allow any amount of whitespace between the two '=' characters
-                    while (j < line.size() && std::isspace((unsigned char)line[j])) j++;
-                    if (j < line.size() && line[j] == '=') {
-                        tokens.push_back({TokenGroup::OPERATOR, "= =", lineno});
-                        i = j + 1;
+        // Operators and punctuation
+        if (isOperatorStart(c)) {
+            // Check multi-char operators: ?xx, **, //
+            if (c == '?') {
+                // need two more letters
+                if (source.ensure(3)) {
+                    std::string op = {c, source.peek(1), source.peek(2)};
+                    if (multi_ops.count(op)) {
+                        tokens.push_back({TokenGroup::OPERATOR, std::move(op), lineno});
+                        source.advance(3);
                         continue;
                     }
                 }
+                lexicalError(std::string("Unknown operator starting with ? at '") + lineAhead(source, 3) + "'", lineno);
+            }
 
-                // Single char operators or delimiters
-                std::string s(1, c);
-                const std::string delims = "(){}[]:;";
-                if (delims.find(c) != std::string::npos) {
-                    tokens.push_back({TokenGroup::DELIMITER, s, lineno});
-                    i++; continue;
+            if (c == '*') {
+                if (source.ensure(2) && source.peek(1) == '*') {
+                    tokens.push_back({TokenGroup::OPERATOR, "**", lineno});
+                    source.advance(2); continue;
+                }
+            }
+            if (c == '/') {
+                if (source.ensure(2) && source.peek(1) == '/') {
+                    tokens.push_back({TokenGroup::OPERATOR, "//", lineno});
+                    source.advance(2); continue;
                 }
-                // single-char operators left
-                if (std::string("+-=").find(c) != std::string::npos) {
-                    tokens.push_back({TokenGroup::OPERATOR, s, lineno});
-                    i++; continue;
+            }
+
+            // New: accept the spaced operator "= =" as a single operator token.
+            if (c == '=') {
+                size_t j = 1;
+                // allow any amount of whitespace between the two '=' characters, on the same line
+                while (source.ensure(j + 1) && source.peek(j) != '\n' && std::isspace((unsigned char)source.peek(j))) j++;
+                if (source.ensure(j + 1) && source.peek(j) == '=') {
+                    tokens.push_back({TokenGroup::OPERATOR, "= =", lineno});
+                    source.advance(j + 1);
+                    continue;
                 }
             }
 
-            // invalid character
-            lexicalError(std::string("Invalid character: '") + c + "'", lineno);
+            // Single char operators or delimiters
+            std::string s(1, c);
+            if (std::strchr("(){}[]:;", c)) {
+                tokens.push_back({TokenGroup::DELIMITER, s, lineno});
+                source.advance(1); continue;
+            }
+            // single-char operators left
+            if (std::strchr("+-=", c)) {
+                tokens.push_back({TokenGroup::OPERATOR, s, lineno});
+                source.advance(1); continue;
+            }
         }
+
+        // invalid character
+        lexicalError(std::string("Invalid character: '") + c + "'", lineno);
     }
 
     // Add EOF token
-    tokens.push_back({TokenGroup::END_OF_FILE, "", lineno+1});
+    tokens.push_back({TokenGroup::END_OF_FILE, "", lineStart ? lineno : lineno + 1});
+}
+
+template void initScanner<BufferSource>(BufferSource&);
+template void initScanner<StringSource>(StringSource&);
+template void initScanner<MappedFileSource>(MappedFileSource&);
+template void initScanner<StreamSource>(StreamSource&);
+
+size_t tokenCount() {
+    return tokens.size();
 }
 
 Token scanner() {
-    if (tokens.empty()) {
+    if (cursor >= tokens.size()) {
         return {TokenGroup::END_OF_FILE, "", 0};
     }
-    Token t = tokens.front();
-    tokens.erase(tokens.begin());
-    return t;
+    // advance a cursor rather than erasing the front, which made scanning quadratic
+    return tokens[cursor++];
 }
 
 void testScanner(std::istream &in) {
-    initScanner(in);
+    StreamSource source(in);
+    initScanner(source);
     while (true) {
         Token t = scanner();
         if (t.group == TokenGroup::END_OF_FILE) {
@@ -3,9 +3,15 @@
 
 #include <string>
 #include <vector>
+#include "inputSource.h"
 #include "token.h"
 
-void initScanner(std::istream &in);
+// scan all of source into tokens; instantiated for each source in inputSource.h
+template <class Source>
+void initScanner(Source& source);
+
+// tokens produced by the last initScanner, including EOF
+size_t tokenCount();
 
 Token scanner();
 
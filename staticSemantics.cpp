@@ -41,6 +41,60 @@ void STATSEM::checkVars() {
 
 }
 
+void STATSEM::insertFunction(const std::string& name, int lineNumber, Node* body) {
+    if (funcTable.find(name) != funcTable.end()) {
+        std::cerr << "ERROR in P3 on line " << lineNumber << ": Subroutine '" << name << "' already defined on line " << funcTable[name].lineDefined << ".\n";
+        exit(EXIT_FAILURE);
+    }
+    funcTable[name] = {lineNumber, false, body};
+}
+
+bool STATSEM::verifyCall(const std::string& name) {
+    auto it = funcTable.find(name);
+    if (it == funcTable.end()) {
+        return false;
+    }
+    it->second.called = true;
+    return true;
+}
+
+void STATSEM::checkFunctions() {
+    for (const auto& entry : funcTable) {
+        if (varTable.count(entry.first)) {
+            std::cerr << "ERROR in P3 on line " << entry.second.lineDefined << ": Subroutine '" << entry.first << "' has the same name as a variable.\n";
+            exit(EXIT_FAILURE);
+        }
+        if (!entry.second.called) {
+            std::cerr << "WARNING in P3: Subroutine '" << entry.first << "' defined on line " << entry.second.lineDefined << " but never called.\n";
+        }
+    }
+
+    // calls return through one return cell per subroutine, so recursion (direct or
+    // through other subroutines) cannot be lowered; search the call graph for a cycle
+    std::map<std::string, int> state; // 0 unvisited, 1 on the current path, 2 done
+    std::function<void(const std::string&)> visit;
+    std::function<void(Node*)> visitCalls = [&](Node* node) {
+        if (!node) return;
+        if (node->kind == NodeKind::Call) {
+            const std::string& callee = node->tokens[0];
+            if (state[callee] == 1) {
+                std::cerr << "ERROR in P3 on line " << node->line_numbers[0] << ": Subroutine '" << callee << "' is called recursively.\n";
+                exit(EXIT_FAILURE);
+            }
+            if (state[callee] == 0) visit(callee);
+        }
+        for (Node* ch : node->children) visitCalls(ch);
+    };
+    visit = [&](const std::string& name) {
+        state[name] = 1;
+        visitCalls(funcTable[name].body);
+        state[name] = 2;
+    };
+    for (const auto& entry : funcTable) {
+        if (state[entry.first] == 0) visit(entry.first);
+    }
+}
+
 STATSEM staticSemantics(Node* root) {
     STATSEM statsem;
     if (!root) {
@@ -60,18 +114,30 @@ STATSEM staticSemantics(Node* root) {
         return true;
     };
 
+    // subroutines are visible everywhere, including before their definition
+    for (Node* ch : root->children) {
+        if (ch && ch->kind == NodeKind::Func) statsem.insertFunction(ch->tokens[0], ch->line_numbers[0], ch->children[0]);
+    }
+
     std::function<void(Node*)> traverse = [&](Node* node) {
         if (!node) return;
 
         // Preorder handling
-        if (node->type == "vars") {
+        if (node->kind == NodeKind::Func) {
+            // name already recorded; only the body needs checking
+        } else if (node->kind == NodeKind::Call) {
+            if (!statsem.verifyCall(node->tokens[0])) {
+                std::cerr << "ERROR in P3 on line " << node->line_numbers[0] << ": Subroutine '" << node->tokens[0] << "' called but never defined.\n";
+                exit(EXIT_FAILURE);
+            }
+        } else if (node->kind == NodeKind::Vars) {
             // tokens: ["int", identifier, "=", number, ... "]
                 const std::string &tok = node->tokens[0];
                 const std::string initValue = node->tokens[1];
                 if (isIdentifier(tok)) {
                     statsem.insert(tok, node->line_numbers[0], std::stoi(initValue));
                 }
-        } else if (node->type == "varList") {
+        } else if (node->kind == NodeKind::VarList) {
             // tokens: [identifier, "=", number]
             if (!node->tokens.empty() && !node->line_numbers.empty()) {
                 const std::string &tok = node->tokens[0];
@@ -98,10 +164,15 @@ STATSEM staticSemantics(Node* root) {
 
     traverse(root);
     statsem.checkVars();
+    statsem.checkFunctions();
     return statsem;
 }
 
 // getter for allocateStorage
 const std::map<std::string, STATSEM::VarInfo>& STATSEM::getVarTable() const {
     return varTable;
-}
\ No newline at end of file
+}
+
+const std::map<std::string, STATSEM::FuncInfo>& STATSEM::getFuncTable() const {
+    return funcTable;
+}
@@ -14,14 +14,27 @@ class STATSEM {
             bool initialized;
             int initValue;
         };
+        struct FuncInfo {
+            int lineDefined;
+            bool called;
+            Node* body;
+        };
     private:
         std::map<std::string, VarInfo> varTable;
+        std::map<std::string, FuncInfo> funcTable;
 
     public:
         void insert(const std::string& varName, int lineNumber, int initValue);
         bool verify(const std::string& varName);
         void checkVars();
 
+        // subroutines: definition (errors on duplicates), call check, and a
+        // check that no subroutine reaches itself through calls
+        void insertFunction(const std::string& name, int lineNumber, Node* body);
+        bool verifyCall(const std::string& name);
+        void checkFunctions();
+        const std::map<std::string, FuncInfo>& getFuncTable() const;
+
         // getter for allocateStorage / other code
         const std::map<std::string, VarInfo>& getVarTable() const;
 };
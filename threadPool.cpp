@@ -0,0 +1,64 @@
+#include <algorithm>
+
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < threads; ++i) workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& fn) {
+    if (n == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        next = 0;
+        count = n;
+        finished = 0;
+        generation++;
+    }
+    wake.notify_all();
+    runTasks();
+    // workers may still be between tasks; fn must outlive every one of them
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return finished == count && busy == 0; });
+    task = nullptr;
+}
+
+// claim indices until none are left
+void ThreadPool::runTasks() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (next < count) {
+        size_t i = next++;
+        const std::function<void(size_t)>& fn = *task;
+        busy++;
+        lock.unlock();
+        fn(i);
+        lock.lock();
+        busy--;
+        if (++finished == count) done.notify_all();
+    }
+    if (busy == 0) done.notify_all();
+}
+
+void ThreadPool::workerLoop() {
+    unsigned seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runTasks();
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads for splitting compiler work by index. the calling thread
+// takes part in every parallelFor, so a pool of size 1 has no workers and runs serially.
+
+class ThreadPool {
+    public:
+        // threads == 0 uses one thread per hardware core
+        explicit ThreadPool(unsigned threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // run task(i) for every i in [0, count), in no particular order; returns once all are done
+        void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+        unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    private:
+        void workerLoop();
+        void runTasks();
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        const std::function<void(size_t)>* task = nullptr;
+        size_t next = 0, count = 0, finished = 0;
+        unsigned generation = 0;
+        unsigned busy = 0;
+        bool stopping = false;
+};
+
+#endif
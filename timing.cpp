@@ -0,0 +1,170 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "timing.h"
+
+static bool enabled = false;
+static std::atomic<uint64_t> allocCount(0);
+static std::atomic<uint64_t> allocBytes(0);
+
+// ---------------------------------------------------------------------------
+// allocation counting: the global operator new only touches the counters once
+// timing is on
+// ---------------------------------------------------------------------------
+
+static void* countedAlloc(size_t size) {
+    if (enabled) {
+        allocCount.fetch_add(1, std::memory_order_relaxed);
+        allocBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+
+// ---------------------------------------------------------------------------
+// spans
+// ---------------------------------------------------------------------------
+
+struct Span {
+    const char* name;
+    int depth;
+    double startUs, wallUs, cpuUs;
+    uint64_t allocs, bytes;
+    long peakRssKb;
+};
+
+static std::vector<Span> spans;
+static std::vector<std::pair<std::string, long long>> counts;
+static int openSpans = 0;
+static std::chrono::steady_clock::time_point origin;
+
+static double wallNowUs() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+static double cpuNowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // kilobytes on Linux
+}
+
+void enableTiming() {
+    if (enabled) return;
+    origin = std::chrono::steady_clock::now();
+    spans.reserve(64);
+    enabled = true;
+}
+
+bool timingEnabled() {
+    return enabled;
+}
+
+PhaseScope::PhaseScope(const char* name) {
+    if (!enabled) return;
+    index = static_cast<int>(spans.size());
+    // start values are parked in the span and replaced by deltas on close
+    spans.push_back({name, openSpans++, wallNowUs(), 0, cpuNowUs(),
+                     allocCount.load(std::memory_order_relaxed),
+                     allocBytes.load(std::memory_order_relaxed), 0});
+}
+
+PhaseScope::~PhaseScope() {
+    if (index < 0) return;
+    Span& s = spans[index];
+    s.wallUs = wallNowUs() - s.startUs;
+    s.cpuUs = cpuNowUs() - s.cpuUs;
+    s.allocs = allocCount.load(std::memory_order_relaxed) - s.allocs;
+    s.bytes = allocBytes.load(std::memory_order_relaxed) - s.bytes;
+    s.peakRssKb = peakRssKb();
+    openSpans--;
+}
+
+void recordCount(const char* name, long long value) {
+    if (enabled) counts.push_back({name, value});
+}
+
+// ---------------------------------------------------------------------------
+// output
+// ---------------------------------------------------------------------------
+
+void printTimingReport(std::ostream& out) {
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::left << std::setw(22) << "phase" << std::right << std::setw(11) << "wall ms"
+        << std::setw(11) << "cpu ms" << std::setw(10) << "allocs" << std::setw(12) << "bytes"
+        << std::setw(12) << "peak RSS" << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& s : spans) {
+        std::string label = std::string(2 * s.depth, ' ') + s.name;
+        out << std::left << std::setw(22) << label << std::right
+            << std::setw(11) << s.wallUs / 1000 << std::setw(11) << s.cpuUs / 1000
+            << std::setw(10) << s.allocs << std::setw(12) << s.bytes
+            << std::setw(9) << s.peakRssKb << " KB\n";
+    }
+    for (const auto& c : counts) {
+        out << std::left << std::setw(22) << c.first << std::right << std::setw(11) << c.second << "\n";
+    }
+    out.flags(flags);
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+bool writeChromeTrace(const std::string& path, std::string& error) {
+    std::ofstream out(path);
+    if (!out) {
+        error = "could not open " + path;
+        return false;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"compile\"}}";
+    double end = 0;
+    for (const auto& s : spans) {
+        out << ",\n{\"name\":" << jsonString(s.name) << ",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << s.startUs << ",\"dur\":" << s.wallUs
+            << ",\"args\":{\"cpu_ms\":" << s.cpuUs / 1000 << ",\"allocs\":" << s.allocs
+            << ",\"alloc_bytes\":" << s.bytes << ",\"peak_rss_kb\":" << s.peakRssKb << "}}";
+        if (s.startUs + s.wallUs > end) end = s.startUs + s.wallUs;
+    }
+    // sizes as one counter sample at the end of the run
+    if (!counts.empty()) {
+        out << ",\n{\"name\":\"sizes\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":" << end << ",\"args\":{";
+        for (size_t i = 0; i < counts.size(); ++i) {
+            out << (i ? "," : "") << jsonString(counts[i].first) << ":" << counts[i].second;
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+    if (!out) {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
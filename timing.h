@@ -0,0 +1,35 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// compile-time instrumentation behind --time-passes and --trace. everything here is a
+// no-op (one predictable branch) until enableTiming() is called.
+
+void enableTiming();
+bool timingEnabled();
+
+// one timed span: wall and CPU time, heap allocations made while it was open and
+// peak RSS when it closed. spans nest; inner spans are included in outer ones.
+class PhaseScope {
+    public:
+        explicit PhaseScope(const char* name);
+        ~PhaseScope();
+        PhaseScope(const PhaseScope&) = delete;
+        PhaseScope& operator=(const PhaseScope&) = delete;
+    private:
+        int index = -1;
+};
+
+// record a named size (tokens, AST nodes, ...) for the report
+void recordCount(const char* name, long long value);
+
+// per-phase table and counts
+void printTimingReport(std::ostream& out);
+
+// spans and counts in Chrome trace-event format (load in Perfetto or chrome://tracing)
+bool writeChromeTrace(const std::string& path, std::string& error);
+
+#endif
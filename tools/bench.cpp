@@ -0,0 +1,353 @@
+// bench: in-process compile-speed harness over .fs25s1 programs
+//
+//   bench [--warmup=N] [--reps=N] [--label=S] [--json=FILE] [--threads=N,N,...] [--sources] prog.fs25s1...
+//
+// each program is read once, then scanned, parsed, checked, compiled and written to
+// memory warmup + reps times. the median of each phase is reported, with lines/s and
+// tokens/s for the whole pipeline and the scaling exponent between successive sizes
+// (1.0 is linear). --threads also times code generation of the largest program at each
+// thread count, reporting the speedup over the first count and checking the .asm is
+// unchanged. --sources also times scanning the largest program through each input source
+// (see inputSource.h), checking they all produce the same tokens. --json writes the same
+// numbers for comparing runs across commits.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../compiler.h"
+#include "../parser.h"
+#include "../scanner.h"
+#include "../staticSemantics.h"
+
+static const char* PHASES[] = {"scan", "parse", "semantics", "codegen", "emit"};
+static const int PHASE_COUNT = 5;
+
+struct Result {
+    std::string file;
+    long long lines = 0, tokens = 0;
+    double phaseMs[PHASE_COUNT] = {};
+    double totalMs = 0;
+};
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+static Result measure(const std::string& path, const std::string& source, int warmup, int reps) {
+    typedef std::chrono::steady_clock Clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    Result r;
+    r.file = path;
+    r.lines = std::count(source.begin(), source.end(), '\n');
+    std::vector<double> samples[PHASE_COUNT], totals;
+    for (int i = 0; i < warmup + reps; ++i) {
+        BufferSource in(source.data(), source.data() + source.size());
+        std::ostringstream out;
+        Clock::time_point t[PHASE_COUNT + 1];
+        t[0] = Clock::now();
+        initScanner(in);
+        r.tokens = static_cast<long long>(tokenCount());
+        t[1] = Clock::now();
+        Node* root = parser();
+        t[2] = Clock::now();
+        STATSEM statsem = staticSemantics(root);
+        t[3] = Clock::now();
+        AsmProgram program = generateProgram(root, statsem);
+        t[4] = Clock::now();
+        writeAsm(program, out);
+        t[5] = Clock::now();
+        freeTree(root);
+        if (i < warmup) continue;
+        for (int p = 0; p < PHASE_COUNT; ++p) samples[p].push_back(ms(t[p], t[p + 1]));
+        totals.push_back(ms(t[0], t[PHASE_COUNT]));
+    }
+    for (int p = 0; p < PHASE_COUNT; ++p) r.phaseMs[p] = median(samples[p]);
+    r.totalMs = median(totals);
+    return r;
+}
+
+// code generation time of one program at one --codegen-threads setting
+struct ThreadResult {
+    int threads = 0;
+    double codegenMs = 0;
+    bool identical = true;      // same .asm as the first thread count
+};
+
+static std::vector<ThreadResult> measureThreads(const std::string& source, const std::vector<int>& threadCounts,
+                                                int warmup, int reps) {
+    typedef std::chrono::steady_clock Clock;
+    BufferSource in(source.data(), source.data() + source.size());
+    Node* root = parser(in);
+    STATSEM statsem = staticSemantics(root);
+    std::vector<ThreadResult> results;
+    std::string reference;
+    for (int threads : threadCounts) {
+        CodegenOptions options;
+        options.codegenThreads = threads;
+        ThreadResult r;
+        r.threads = threads;
+        std::vector<double> samples;
+        std::string text;
+        for (int i = 0; i < warmup + reps; ++i) {
+            Clock::time_point start = Clock::now();
+            AsmProgram program = generateProgram(root, statsem, options);
+            Clock::time_point end = Clock::now();
+            if (i >= warmup) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            if (i + 1 == warmup + reps) {
+                std::ostringstream out;
+                writeAsm(program, out);
+                text = out.str();
+            }
+        }
+        r.codegenMs = median(samples);
+        if (results.empty()) reference = text;
+        r.identical = text == reference;
+        results.push_back(r);
+    }
+    freeTree(root);
+    return results;
+}
+
+// scan time of one program through one input source, including opening it
+struct SourceResult {
+    std::string source;
+    double scanMs = 0;
+    bool identical = true;      // same tokens as the first source
+};
+
+// every token the last initScanner produced, one per line
+static std::string scannedTokens() {
+    std::string text;
+    for (Token t = scanner(); ; t = scanner()) {
+        text += std::to_string(static_cast<int>(t.group)) + " " + t.instance + " " + std::to_string(t.line) + "\n";
+        if (t.group == TokenGroup::END_OF_FILE) return text;
+    }
+}
+
+static std::vector<SourceResult> measureSources(const std::string& path, const std::string& source, int warmup,
+                                                int reps) {
+    typedef std::chrono::steady_clock Clock;
+    // each returns false if the source could not be opened
+    typedef bool (*Scan)(const std::string& path, const std::string& source);
+    static const struct { const char* name; Scan scan; } policies[] = {
+        {"buffer", [](const std::string&, const std::string& source) {
+            BufferSource in(source.data(), source.data() + source.size());
+            initScanner(in);
+            return true;
+        }},
+        {"string (copied)", [](const std::string&, const std::string& source) {
+            StringSource in(source);
+            initScanner(in);
+            return true;
+        }},
+        {"mapped file", [](const std::string& path, const std::string&) {
+            MappedFileSource in;
+            std::string error;
+            if (!in.open(path, error)) return false;
+            initScanner(in);
+            return true;
+        }},
+        {"stream (file)", [](const std::string& path, const std::string&) {
+            std::ifstream file(path);
+            if (!file) return false;
+            StreamSource in(file);
+            initScanner(in);
+            return true;
+        }},
+        {"stream (memory)", [](const std::string&, const std::string& source) {
+            std::istringstream text(source);
+            StreamSource in(text);
+            initScanner(in);
+            return true;
+        }},
+    };
+    std::vector<SourceResult> results;
+    std::string reference;
+    for (const auto& policy : policies) {
+        SourceResult r;
+        r.source = policy.name;
+        std::vector<double> samples;
+        for (int i = 0; i < warmup + reps; ++i) {
+            Clock::time_point start = Clock::now();
+            if (!policy.scan(path, source)) {
+                std::cerr << "Could not open file: " << path << std::endl;
+                std::exit(1);
+            }
+            Clock::time_point end = Clock::now();
+            if (i >= warmup) samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        r.scanMs = median(samples);
+        std::string text = scannedTokens();
+        if (results.empty()) reference = text;
+        r.identical = text == reference;
+        results.push_back(r);
+    }
+    return results;
+}
+
+static double perSecond(long long n, double ms) {
+    return ms > 0 ? n / (ms / 1000) : 0;
+}
+
+// growth of time relative to growth of input between two runs
+static double scaling(const Result& a, const Result& b) {
+    if (a.lines <= 0 || b.lines <= a.lines || a.totalMs <= 0 || b.totalMs <= 0) return 0;
+    return std::log(b.totalMs / a.totalMs) / std::log(static_cast<double>(b.lines) / a.lines);
+}
+
+static void writeJson(std::ostream& out, const std::string& label, int warmup, int reps,
+                      const std::vector<Result>& results, const std::vector<ThreadResult>& threads,
+                      const std::vector<SourceResult>& sources) {
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"label\": \"" << label << "\",\n  \"warmup\": " << warmup << ",\n  \"reps\": " << reps
+        << ",\n  \"programs\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"file\": \"" << r.file << "\", \"lines\": " << r.lines << ", \"tokens\": " << r.tokens
+            << ", \"total_ms\": " << r.totalMs << ", \"lines_per_s\": " << perSecond(r.lines, r.totalMs)
+            << ", \"tokens_per_s\": " << perSecond(r.tokens, r.totalMs) << ", \"phases_ms\": {";
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            out << (p ? ", " : "") << "\"" << PHASES[p] << "\": " << r.phaseMs[p];
+        }
+        out << "}";
+        if (i > 0) out << ", \"scaling\": " << scaling(results[i - 1], r);
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]";
+    if (!threads.empty()) {
+        out << ",\n  \"threads\": {\"file\": \"" << results.back().file << "\", \"codegen\": [\n";
+        for (size_t i = 0; i < threads.size(); ++i) {
+            const ThreadResult& t = threads[i];
+            out << "    {\"threads\": " << t.threads << ", \"ms\": " << t.codegenMs << ", \"speedup\": "
+                << (t.codegenMs > 0 ? threads[0].codegenMs / t.codegenMs : 0) << ", \"identical\": "
+                << (t.identical ? "true" : "false") << "}" << (i + 1 < threads.size() ? "," : "") << "\n";
+        }
+        out << "  ]}";
+    }
+    if (!sources.empty()) {
+        out << ",\n  \"sources\": {\"file\": \"" << results.back().file << "\", \"scan\": [\n";
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const SourceResult& s = sources[i];
+            out << "    {\"source\": \"" << s.source << "\", \"ms\": " << s.scanMs << ", \"identical\": "
+                << (s.identical ? "true" : "false") << "}" << (i + 1 < sources.size() ? "," : "") << "\n";
+        }
+        out << "  ]}";
+    }
+    out << "\n}\n";
+}
+
+int main(int argc, char** argv) {
+    int warmup = 1, reps = 5;
+    std::string label = "unlabeled", jsonPath;
+    std::vector<std::string> files;
+    std::vector<int> threadCounts;
+    bool compareSources = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 9, "--warmup=") == 0) warmup = std::atoi(arg.c_str() + 9);
+        else if (arg.compare(0, 7, "--reps=") == 0) reps = std::max(1, std::atoi(arg.c_str() + 7));
+        else if (arg.compare(0, 8, "--label=") == 0) label = arg.substr(8);
+        else if (arg.compare(0, 7, "--json=") == 0) jsonPath = arg.substr(7);
+        else if (arg.compare(0, 10, "--threads=") == 0) {
+            std::stringstream list(arg.substr(10));
+            std::string count;
+            while (std::getline(list, count, ',')) threadCounts.push_back(std::atoi(count.c_str()));
+        } else if (arg == "--sources") compareSources = true;
+        else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--warmup=N] [--reps=N] [--label=S] [--json=FILE] [--threads=N,N,...] [--sources] files..."
+                      << std::endl;
+            return 1;
+        } else files.push_back(arg);
+    }
+
+    std::vector<Result> results;
+    std::vector<std::string> sources;
+    for (const auto& path : files) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Could not open file: " << path << std::endl;
+            return 1;
+        }
+        std::stringstream source;
+        source << in.rdbuf();
+        sources.push_back(source.str());
+        results.push_back(measure(path, sources.back(), warmup, reps));
+    }
+    std::vector<size_t> order(results.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return results[a].lines < results[b].lines; });
+    std::vector<Result> sorted;
+    for (size_t i : order) sorted.push_back(results[i]);
+    results.swap(sorted);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(28) << "program" << std::right << std::setw(8) << "lines"
+              << std::setw(10) << "ms" << std::setw(12) << "lines/s" << std::setw(12) << "tokens/s"
+              << std::setw(9) << "scaling" << "\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::cout << std::left << std::setw(28) << r.file << std::right << std::setw(8) << r.lines
+                  << std::setw(10) << r.totalMs << std::setw(12) << std::setprecision(0)
+                  << perSecond(r.lines, r.totalMs) << std::setw(12) << perSecond(r.tokens, r.totalMs)
+                  << std::setprecision(2);
+        if (i > 0) std::cout << std::setw(9) << scaling(results[i - 1], r);
+        std::cout << "\n";
+    }
+
+    std::vector<ThreadResult> threads;
+    if (!threadCounts.empty() && !results.empty()) {
+        threads = measureThreads(sources[order.back()], threadCounts, warmup, reps);
+        std::cout << "\ncode generation and optimization of " << results.back().file << " by codegen thread count ("
+                  << std::thread::hardware_concurrency() << " hardware threads)\n";
+        std::cout << std::setw(8) << "threads" << std::setw(12) << "ms" << std::setw(10) << "speedup"
+                  << std::setw(11) << "identical" << "\n";
+        for (const auto& t : threads) {
+            std::cout << std::setw(8) << t.threads << std::setw(12) << t.codegenMs << std::setw(10)
+                      << (t.codegenMs > 0 ? threads[0].codegenMs / t.codegenMs : 0) << std::setw(11)
+                      << (t.identical ? "yes" : "NO") << "\n";
+        }
+    }
+
+    std::vector<SourceResult> scans;
+    if (compareSources && !results.empty()) {
+        scans = measureSources(results.back().file, sources[order.back()], warmup, reps);
+        std::cout << "\nscanning " << results.back().file << " by input source\n";
+        std::cout << std::left << std::setw(18) << "source" << std::right << std::setw(12) << "ms" << std::setw(14)
+                  << "MB/s" << std::setw(11) << "identical" << "\n";
+        double megabytes = sources[order.back()].size() / 1e6;
+        for (const auto& s : scans) {
+            std::cout << std::left << std::setw(18) << s.source << std::right << std::setw(12) << s.scanMs
+                      << std::setw(14) << (s.scanMs > 0 ? megabytes / (s.scanMs / 1000) : 0) << std::setw(11)
+                      << (s.identical ? "yes" : "NO") << "\n";
+        }
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        if (!out) {
+            std::cerr << "Could not open output file: " << jsonPath << std::endl;
+            return 1;
+        }
+        writeJson(out, label, warmup, reps, results, threads, scans);
+    }
+    for (const auto& t : threads) {
+        if (!t.identical) return 1;
+    }
+    for (const auto& s : scans) {
+        if (!s.identical) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,227 @@
+// codequality: static metrics of generated code, checked against a baseline
+//
+//   codequality --baseline=FILE [--threshold=PCT] [--update] [--rewrites=FILE] [--input=FILE] prog.fs25s1...
+//
+// each program is compiled in-process with default options and the compiler's built-in
+// expression rewrite table, or the one given with --rewrites. recorded per program:
+// final instruction count and count per opcode, temps and labels allocated during
+// traversal, data cells from allocateStorage and data cells left after optimization.
+// exits 1 if any metric grows more than PCT percent (default 0) over the baseline;
+// --update rewrites the baseline from the current compiler instead.
+//
+// with --input, every program is also compiled at -O0, -O1 and -O2 (as the compiler's -O
+// flags set the options) and run on the VM over FILE; exits 1 as well if the VM cannot
+// load a program, or the output at -O1 or -O2, or the error it stops with, differs
+// from -O0's.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "../compiler.h"
+#include "../parser.h"
+#include "../passManager.h"
+#include "../scanner.h"
+#include "../staticSemantics.h"
+#include "../vm.h"
+
+typedef std::map<std::string, long long> Metrics;
+
+static int usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --baseline=FILE [--threshold=PCT] [--update] [--rewrites=FILE]"
+              << " [--input=FILE] files..." << std::endl;
+    return 1;
+}
+
+static std::string programName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind(".fs25s1");
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static Metrics measure(MappedFileSource& source, const CodegenOptions& options) {
+    Node* root = parser(source);
+    STATSEM statsem = staticSemantics(root);
+    CodegenStats stats;
+    AsmProgram program = generateProgram(root, statsem, options, &stats);
+    freeTree(root);
+
+    Metrics m;
+    m["instructions"] = static_cast<long long>(program.code.size());
+    for (const auto& instr : program.code) m["op." + instr.op]++;
+    m["temps"] = stats.temps;
+    m["labels"] = stats.labels;
+    m["cells.allocated"] = stats.cellsAllocated;
+    m["cells.emitted"] = static_cast<long long>(program.data.size());
+    return m;
+}
+
+// what a program prints when compiled at an -O level and run over input, followed by
+// the error it stops with (without the instruction number, which differs between levels)
+static std::string runAtLevel(const std::string& path, CodegenOptions options, int level, const std::string& input) {
+    options.passes = pipelineForLevel(level);
+    options.unrollBudget = unrollBudgetForLevel(level);
+    options.inlineBudget = inlineBudgetForLevel(level);
+    options.strengthReduce = level >= 2;
+    if (level == 0) options.rewrites.clear();
+
+    MappedFileSource source;
+    std::string error;
+    if (!source.open(path, error)) {
+        std::cerr << "Could not open file: " << path << std::endl;
+        std::exit(1);
+    }
+    Node* root = parser(source);
+    STATSEM statsem = staticSemantics(root);
+    AsmProgram program = generateProgram(root, statsem, options);
+    freeTree(root);
+
+    VMImage image;
+    if (!decodeProgram(program, image, error)) return "not runnable: " + error + "\n";
+    std::istringstream in(input);
+    std::ostringstream out;
+    VMResult result = runProgram(image, in, out);
+    if (!result.ok) out << "error: " << result.error.substr(result.error.find(": ") + 2) << "\n";
+    return out.str();
+}
+
+// baseline lines: program metric value ('#' starts a comment)
+static bool readBaseline(const std::string& path, std::map<std::string, Metrics>& baseline) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream words(line);
+        std::string program, metric;
+        long long value;
+        if (words >> program >> metric >> value) baseline[program][metric] = value;
+    }
+    return true;
+}
+
+static bool writeBaseline(const std::string& path, const std::map<std::string, Metrics>& results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# generated-code metrics; regenerate with: make codequality-update\n";
+    for (const auto& program : results) {
+        for (const auto& metric : program.second) {
+            out << program.first << " " << metric.first << " " << metric.second << "\n";
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    std::string baselinePath;
+    double threshold = 0;
+    bool update = false;
+    CodegenOptions options;
+    options.rewrites = builtinRewrites();
+    std::string inputPath;
+    std::map<std::string, Metrics> results;
+    std::map<std::string, std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 11, "--baseline=") == 0) baselinePath = arg.substr(11);
+        else if (arg.compare(0, 12, "--threshold=") == 0) threshold = std::atof(arg.c_str() + 12);
+        else if (arg == "--update") update = true;
+        else if (arg.compare(0, 11, "--rewrites=") == 0) {
+            std::string error;
+            options.rewrites.clear();
+            if (!readRewrites(arg.substr(11), options.rewrites, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.compare(0, 8, "--input=") == 0) inputPath = arg.substr(8);
+        else if (arg.compare(0, 2, "--") == 0) return usage(argv[0]);
+        else {
+            MappedFileSource source;
+            std::string error;
+            if (!source.open(arg, error)) {
+                std::cerr << "Could not open file: " << arg << std::endl;
+                return 1;
+            }
+            results[programName(arg)] = measure(source, options);
+            paths[programName(arg)] = arg;
+        }
+    }
+    if (baselinePath.empty()) return usage(argv[0]);
+
+    if (update) {
+        if (!writeBaseline(baselinePath, results)) {
+            std::cerr << "Could not write baseline: " << baselinePath << std::endl;
+            return 1;
+        }
+        std::cout << "baseline updated: " << results.size() << " programs" << std::endl;
+        return 0;
+    }
+
+    std::map<std::string, Metrics> baseline;
+    if (!readBaseline(baselinePath, baseline)) {
+        std::cerr << "Could not read baseline: " << baselinePath << std::endl;
+        return 1;
+    }
+    int regressions = 0, improvements = 0;
+    for (const auto& program : results) {
+        auto base = baseline.find(program.first);
+        if (base == baseline.end()) {
+            std::cout << program.first << ": no baseline" << std::endl;
+            continue;
+        }
+        // a metric absent on either side counts as zero
+        Metrics all = base->second;
+        for (const auto& metric : program.second) all.insert({metric.first, 0});
+        for (const auto& metric : all) {
+            auto cur = program.second.find(metric.first);
+            auto old = base->second.find(metric.first);
+            long long now = cur == program.second.end() ? 0 : cur->second;
+            long long was = old == base->second.end() ? 0 : old->second;
+            if (now > was + was * threshold / 100) {
+                std::cout << "REGRESSION " << program.first << " " << metric.first << ": " << was << " -> " << now
+                          << std::endl;
+                regressions++;
+            } else if (now < was) {
+                std::cout << "improved   " << program.first << " " << metric.first << ": " << was << " -> " << now
+                          << std::endl;
+                improvements++;
+            }
+        }
+    }
+
+    int differences = 0;
+    if (!inputPath.empty()) {
+        std::ifstream file(inputPath);
+        if (!file) {
+            std::cerr << "Could not read input: " << inputPath << std::endl;
+            return 1;
+        }
+        std::ostringstream input;
+        input << file.rdbuf();
+        for (const auto& program : paths) {
+            std::string reference = runAtLevel(program.second, options, 0, input.str());
+            if (reference.compare(0, 13, "not runnable:") == 0) {
+                std::cout << "NOT RUNNABLE " << program.first << ": " << reference.substr(14);
+                differences++;
+                continue;
+            }
+            for (int level = 1; level <= 2; ++level) {
+                if (runAtLevel(program.second, options, level, input.str()) == reference) continue;
+                std::cout << "OUTPUT DIFFERS " << program.first << ": -O" << level << " from -O0" << std::endl;
+                differences++;
+            }
+        }
+    }
+
+    std::cout << results.size() << " programs, " << regressions << " regressions, " << improvements
+              << " improvements";
+    if (!inputPath.empty()) std::cout << ", " << differences << " output differences";
+    std::cout << std::endl;
+    if (improvements && !regressions) std::cout << "run make codequality-update to lock in the improvements" << std::endl;
+    return regressions || differences ? 1 : 0;
+}
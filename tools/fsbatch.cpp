@@ -0,0 +1,139 @@
+// fsbatch: run one compiled program over many input records
+//
+//   fsbatch [--serial] prog.asm records.txt
+//   fsbatch --bench [--reps=N] prog.asm records.txt
+//
+// the program is a .asm from the compiler (or a .fso object). each line of records.txt is
+// one record: the integers its scans read, in order. one line per record is written to
+// stdout with the values it output, followed by "error: ..." if it failed. records run in
+// lockstep groups (see batch.h); --serial runs them one after another through the
+// interpreter instead. --bench times both over the same records, reports records/s and
+// the speedup on stderr, and fails if any record's output differs.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../batch.h"
+#include "../objectFile.h"
+#include "../vm.h"
+
+static int usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--serial] <prog.asm|prog.fso> <records.txt>" << std::endl;
+    std::cerr << "       " << prog << " --bench [--reps=N] <prog.asm|prog.fso> <records.txt>" << std::endl;
+    return 1;
+}
+
+static bool loadProgram(const std::string& path, VMImage& image, std::string& error) {
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".fso") == 0) return loadObject(path, image, error);
+    std::ifstream in(path);
+    if (!in) {
+        error = "could not open file";
+        return false;
+    }
+    AsmProgram program;
+    return parseAsm(in, program, error) && decodeProgram(program, image, error);
+}
+
+static bool loadRecords(const std::string& path, std::vector<std::vector<int32_t>>& records, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "could not open file";
+        return false;
+    }
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream words(line);
+        std::vector<int32_t> record;
+        long long value = 0;
+        while (words >> value) record.push_back(static_cast<int32_t>(value));
+        if (!words.eof()) {
+            error = "line " + std::to_string(lineNo) + ": expected integers";
+            return false;
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+static void printResults(const std::vector<BatchResult>& results, std::ostream& out) {
+    for (const auto& result : results) {
+        const char* separator = "";
+        for (int32_t value : result.output) {
+            out << separator << value;
+            separator = " ";
+        }
+        if (!result.ok) out << separator << "error: " << result.error;
+        out << '\n';
+    }
+}
+
+static bool sameResults(const std::vector<BatchResult>& a, const std::vector<BatchResult>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].ok != b[i].ok || a[i].error != b[i].error || a[i].output != b[i].output) return false;
+    }
+    return true;
+}
+
+// best of reps runs, in records per second
+static double recordsPerSecond(const VMImage& image, const std::vector<std::vector<int32_t>>& records, bool serial,
+                               int reps, std::vector<BatchResult>& results) {
+    typedef std::chrono::steady_clock Clock;
+    double best = 0;
+    for (int i = 0; i < reps; ++i) {
+        Clock::time_point start = Clock::now();
+        results = runBatch(image, records, serial);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = std::max(best, records.size() / std::max(seconds, 1e-9));
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    bool serial = false, bench = false;
+    int reps = 3;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--serial") serial = true;
+        else if (arg == "--bench") bench = true;
+        else if (arg.compare(0, 7, "--reps=") == 0) reps = std::max(1, std::stoi(arg.substr(7)));
+        else if (!arg.empty() && arg[0] == '-') return usage(argv[0]);
+        else files.push_back(arg);
+    }
+    if (files.size() != 2) return usage(argv[0]);
+
+    VMImage image;
+    std::vector<std::vector<int32_t>> records;
+    std::string error;
+    if (!loadProgram(files[0], image, error)) {
+        std::cerr << files[0] << ": " << error << std::endl;
+        return 1;
+    }
+    if (!loadRecords(files[1], records, error)) {
+        std::cerr << files[1] << ": " << error << std::endl;
+        return 1;
+    }
+
+    if (!bench) {
+        printResults(runBatch(image, records, serial), std::cout);
+        return 0;
+    }
+    std::vector<BatchResult> serialResults, batchResults;
+    double serialRate = recordsPerSecond(image, records, true, reps, serialResults);
+    double batchRate = recordsPerSecond(image, records, false, reps, batchResults);
+    std::cerr << records.size() << " records, " << BATCH_LANES << " lanes (" << batchTarget() << ")" << std::endl;
+    std::cerr << "serial:  " << static_cast<long long>(serialRate) << " records/s" << std::endl;
+    std::cerr << "batched: " << static_cast<long long>(batchRate) << " records/s ("
+              << batchRate / std::max(serialRate, 1e-9) << "x)" << std::endl;
+    if (!sameResults(serialResults, batchResults)) {
+        std::cerr << "batched output differs from serial" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// fsobj: convert between .asm text and the .fso binary object format
+//
+//   fsobj asm2obj prog.asm prog.fso
+//   fsobj obj2asm prog.fso prog.asm
+//   fsobj run prog.fso            (execute, scan input from stdin)
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "../compiler.h"
+#include "../objectFile.h"
+#include "../vm.h"
+
+static int usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " asm2obj <in.asm> <out.fso>" << std::endl;
+    std::cerr << "       " << prog << " obj2asm <in.fso> <out.asm>" << std::endl;
+    std::cerr << "       " << prog << " run <in.fso>" << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage(argv[0]);
+    std::string mode = argv[1];
+    std::string error;
+
+    if (mode == "asm2obj" && argc == 4) {
+        std::ifstream in(argv[2]);
+        if (!in) {
+            std::cerr << "Could not open file: " << argv[2] << std::endl;
+            return 1;
+        }
+        AsmProgram program;
+        if (!parseAsm(in, program, error) || !writeObject(program, argv[3], error)) {
+            std::cerr << argv[2] << ": " << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    VMImage image;
+    if ((mode == "obj2asm" && argc == 4) || (mode == "run" && argc == 3)) {
+        if (!loadObject(argv[2], image, error)) {
+            std::cerr << argv[2] << ": " << error << std::endl;
+            return 1;
+        }
+    } else {
+        return usage(argv[0]);
+    }
+
+    if (mode == "run") {
+        VMResult result = runProgram(image, std::cin, std::cout);
+        if (!result.ok) {
+            std::cerr << "Runtime error: " << result.error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    std::ofstream out(argv[3]);
+    if (!out) {
+        std::cerr << "Could not open output file: " << argv[3] << std::endl;
+        return 1;
+    }
+    writeAsm(imageToProgram(image), out);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// genprog: seeded generator of valid .fs25s1 programs for compile-speed benchmarks
+//
+//   genprog [--seed=N] [--statements=N] [--depth=N] [--expr-depth=N] [--expr-length=N]
+//           [--vars=N] [--comments=PCT] [-o file]
+//
+// programs follow the grammar comment in parser.cpp and pass static semantics:
+// every identifier is declared once (globals xvN, block locals xbN) and used.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct GenOptions {
+    unsigned seed = 1;
+    int statements = 1000;   // approximate number of statements
+    int depth = 4;           // max block/cond/loop nesting
+    int exprDepth = 3;       // max parenthesis nesting
+    int exprLength = 4;      // max operands per expression level
+    int vars = 16;           // global variables
+    int comments = 10;       // percent of lines followed by a comment
+};
+
+static GenOptions opts;
+static std::mt19937 rng;
+static std::string text;
+static int blockCounter = 0;
+static int remaining = 0;
+
+static int pick(int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+static bool chance(int percent) {
+    return pick(0, 99) < percent;
+}
+
+static std::string variable(const std::vector<std::string>& scope) {
+    return scope[pick(0, static_cast<int>(scope.size()) - 1)];
+}
+
+static void line(int indent, const std::string& s) {
+    text.append(2 * indent, ' ');
+    text += s;
+    if (chance(opts.comments)) text += " @ generated statement " + std::to_string(remaining) + " @";
+    text += "\n";
+}
+
+// R -> ( exp ) | identifier | integer
+static std::string expression(const std::vector<std::string>& scope, int depth);
+
+static std::string operand(const std::vector<std::string>& scope, int depth) {
+    if (depth < opts.exprDepth && chance(20)) return "( " + expression(scope, depth + 1) + " )";
+    if (chance(60)) return variable(scope);
+    return std::to_string(pick(0, 999));
+}
+
+// exp -> M ** exp | M // exp | M ; M -> N + M | N ; N -> R - N | - N | R
+static std::string expression(const std::vector<std::string>& scope, int depth) {
+    static const char* ops[] = {"+", "-", "**", "//"};
+    int count = pick(1, opts.exprLength);
+    std::string e = chance(10) ? "- " + operand(scope, depth) : operand(scope, depth);
+    for (int i = 1; i < count; ++i) {
+        e += std::string(" ") + ops[pick(0, 3)] + " " + operand(scope, depth);
+    }
+    return e;
+}
+
+static std::string relational() {
+    // ';' is scanned as a delimiter and never reaches relational(), so it is not generated
+    static const char* rels[] = {"?le", "?ge", "?lt", "?gt", "?ne", "?eq", "= ="};
+    return rels[pick(0, 6)];
+}
+
+static void statement(std::vector<std::string>& scope, int indent, int depth);
+
+// { vars stats } with fresh locals, each used at least once
+static void blockStatement(std::vector<std::string>& scope, int indent, int depth) {
+    line(indent, "{");
+    std::vector<std::string> locals;
+    int count = pick(0, 2);
+    if (count > 0) {
+        std::string decl = "int";
+        for (int i = 0; i < count; ++i) {
+            locals.push_back("xb" + std::to_string(blockCounter++));
+            decl += " " + locals.back() + " = " + std::to_string(pick(0, 99));
+        }
+        line(indent + 1, decl + " :");
+    }
+    std::vector<std::string> inner = scope;
+    inner.insert(inner.end(), locals.begin(), locals.end());
+    int stats = pick(1, 4);
+    for (int i = 0; i < stats && (i == 0 || remaining > 0); ++i) statement(inner, indent + 1, depth + 1);
+    for (const auto& local : locals) line(indent + 1, "output " + local + " :");
+    line(indent, "}");
+}
+
+static void statement(std::vector<std::string>& scope, int indent, int depth) {
+    remaining--;
+    int kind = pick(0, 99);
+    bool nest = depth < opts.depth;
+    if (nest && kind < 10) {
+        blockStatement(scope, indent, depth);
+    } else if (nest && kind < 20) {
+        line(indent, "cond [ " + variable(scope) + " " + relational() + " " + expression(scope, 0) + " ]");
+        statement(scope, indent + 1, depth + 1);
+    } else if (nest && kind < 28) {
+        line(indent, "loop [ " + variable(scope) + " " + relational() + " " + expression(scope, 0) + " ]");
+        statement(scope, indent + 1, depth + 1);
+    } else if (kind < 35) {
+        line(indent, "scan " + variable(scope) + " :");
+    } else if (kind < 50) {
+        line(indent, "output " + expression(scope, 0) + " :");
+    } else {
+        line(indent, "set " + variable(scope) + " = " + expression(scope, 0) + " :");
+    }
+}
+
+static bool intFlag(const std::string& arg, const char* name, int& value) {
+    std::string prefix = std::string("--") + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = std::atoi(arg.c_str() + prefix.size());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string outPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        int seed = 0;
+        if (intFlag(arg, "seed", seed)) opts.seed = static_cast<unsigned>(seed);
+        else if (intFlag(arg, "statements", opts.statements)) {}
+        else if (intFlag(arg, "depth", opts.depth)) {}
+        else if (intFlag(arg, "expr-depth", opts.exprDepth)) {}
+        else if (intFlag(arg, "expr-length", opts.exprLength)) {}
+        else if (intFlag(arg, "vars", opts.vars)) {}
+        else if (intFlag(arg, "comments", opts.comments)) {}
+        else if (arg == "-o" && i + 1 < argc) outPath = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--seed=N] [--statements=N] [--depth=N] [--expr-depth=N]"
+                      << " [--expr-length=N] [--vars=N] [--comments=PCT] [-o file]" << std::endl;
+            return 1;
+        }
+    }
+    if (opts.vars < 1) opts.vars = 1;
+    if (opts.exprLength < 1) opts.exprLength = 1;
+    rng.seed(opts.seed);
+
+    std::vector<std::string> globals;
+    std::string decl = "int";
+    for (int i = 0; i < opts.vars; ++i) {
+        globals.push_back("xv" + std::to_string(i));
+        decl += " " + globals.back() + " = " + std::to_string(pick(0, 99));
+    }
+    text = "go\n" + decl + " :\n{\n";
+    remaining = opts.statements;
+    while (remaining > 0) statement(globals, 1, 0);
+    for (const auto& g : globals) line(1, "output " + g + " :");
+    text += "}\nexit\n";
+
+    if (outPath.empty()) {
+        std::cout << text;
+        return 0;
+    }
+    std::ofstream out(outPath);
+    if (!out) {
+        std::cerr << "Could not open output file: " << outPath << std::endl;
+        return 1;
+    }
+    out << text;
+    return 0;
+}
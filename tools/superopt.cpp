@@ -0,0 +1,572 @@
+// superopt: search for the shortest accumulator code for small expression shapes
+//
+//   superopt [--max-length=K] [--max-ops=N] [--seed=N] [-o FILE]
+//   superopt --measure --rewrites=FILE [--input=FILE] prog.fs25s1...
+//
+// the first form enumerates every expression shape with up to N operators (default 2)
+// over leaf operands and at most one arbitrary subexpression e, and for each one searches
+// the sequences of up to K instructions (default 5, not counting e's own code) over LOAD
+// STORE ADD SUB MULT DIV with the shape's leaves, two temps and the immediates 0 and 1.
+// a sequence is accepted when it computes the shape's value and traps on the same zero
+// divisors under the VM's arithmetic (32-bit wrapping, division truncating, x // -1
+// negating): first on a few dozen test vectors while searching, then on every assignment
+// from -3..3, every assignment of edge values and random ones. the cheapest accepted
+// sequence per shape, if shorter than the genExp/genM/genN template, goes to the rewrite
+// table (rewrites.h), on stdout or FILE.
+//
+// --measure compiles each program with and without the table and runs both on the VM
+// with the same input (FILE, or none), reporting instruction counts before and after.
+// exits 1 if the outputs differ.
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../compiler.h"
+#include "../costModel.h"
+#include "../parser.h"
+#include "../rewrites.h"
+#include "../staticSemantics.h"
+#include "../vm.h"
+
+// test vectors carried through the search
+static const int LANES = 32;
+// operand slots: leaves a..d, then e
+static const int VARS = 5;
+static const int E = 4;
+static const int TEMPS = 2;
+
+static int usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--max-length=K] [--max-ops=N] [--seed=N] [-o FILE]" << std::endl;
+    std::cerr << "       " << prog << " --measure --rewrites=FILE [--input=FILE] files..." << std::endl;
+    return 1;
+}
+
+static int32_t wrapAdd(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+static int32_t wrapSub(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+static int32_t wrapMul(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+
+// instructions searched over; EVAL computes e into ACC
+enum Op { LOAD, STORE, ADD, SUB, MULT, DIV, EVAL };
+static const char* const OP_NAMES[] = {"LOAD", "STORE", "ADD", "SUB", "MULT", "DIV", "EVAL"};
+
+// ACC op x as the VM computes it; false on a zero divisor
+static bool apply(Op op, int32_t& acc, int32_t x) {
+    switch (op) {
+        case LOAD: acc = x; break;
+        case ADD: acc = wrapAdd(acc, x); break;
+        case SUB: acc = wrapSub(acc, x); break;
+        case MULT: acc = wrapMul(acc, x); break;
+        case DIV:
+            if (x == 0) return false;
+            acc = x == -1 ? wrapSub(0, acc) : acc / x;
+            break;
+        default: break;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// shapes
+// ---------------------------------------------------------------------------
+
+// every tree with exactly n operators; operands are left as 'a' to be named later
+static std::vector<Shape> trees(int n) {
+    std::vector<Shape> result;
+    if (n == 0) {
+        Shape leaf;
+        leaf.operand = 'a';
+        result.push_back(leaf);
+        return result;
+    }
+    for (const auto& child : trees(n - 1)) {
+        Shape neg;
+        neg.op = "-";
+        neg.children.push_back(child);
+        result.push_back(neg);
+    }
+    for (const char* op : {"+", "-", "**", "//"}) {
+        for (int left = 0; left < n; ++left) {
+            for (const auto& l : trees(left)) {
+                for (const auto& r : trees(n - 1 - left)) {
+                    Shape bin;
+                    bin.op = op;
+                    bin.children = {l, r};
+                    result.push_back(bin);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+static int countOperands(const Shape& shape) {
+    if (shape.op.empty()) return 1;
+    int n = 0;
+    for (const auto& child : shape.children) n += countOperands(child);
+    return n;
+}
+
+// name the operands a, b, ... left to right, with the one at position ePos (if any) as e
+static void nameOperands(Shape& shape, int ePos, int& position, char& next) {
+    if (shape.op.empty()) {
+        shape.operand = position++ == ePos ? 'e' : next++;
+        return;
+    }
+    for (auto& child : shape.children) nameOperands(child, ePos, position, next);
+}
+
+static std::vector<Shape> allShapes(int maxOps) {
+    std::vector<Shape> result;
+    for (int n = 1; n <= maxOps; ++n) {
+        for (const auto& tree : trees(n)) {
+            int operands = countOperands(tree);
+            for (int ePos = -1; ePos < operands; ++ePos) {
+                Shape named = tree;
+                int position = 0;
+                char next = 'a';
+                nameOperands(named, ePos, position, next);
+                result.push_back(named);
+            }
+        }
+    }
+    return result;
+}
+
+// value of a shape for one assignment of the operands; false if any division by zero
+// (the template evaluates every operand, so every divisor is tested)
+static bool evaluate(const Shape& shape, const int32_t* vars, int32_t& value) {
+    if (shape.op.empty()) {
+        value = vars[shape.operand == 'e' ? E : shape.operand - 'a'];
+        return true;
+    }
+    int32_t left, right;
+    if (shape.children.size() == 1) {
+        if (!evaluate(shape.children[0], vars, right)) return false;
+        value = wrapSub(0, right);
+        return true;
+    }
+    bool ok = evaluate(shape.children[0], vars, left);
+    ok = evaluate(shape.children[1], vars, right) && ok;
+    if (!ok) return false;
+    value = left;
+    const std::string& op = shape.op;
+    return apply(op == "+" ? ADD : op == "-" ? SUB : op == "**" ? MULT : DIV, value, right);
+}
+
+// ---------------------------------------------------------------------------
+// search
+// ---------------------------------------------------------------------------
+
+// instruction alphabet: op and operand slot (0..3 a leaf, E, TEMP0 + i a temp, IMM0 + v an immediate)
+static const int TEMP0 = 5;
+static const int IMM0 = 7;
+static const int IMMS = 2;
+
+struct Candidate {
+    Op op;
+    int operand;
+};
+
+struct LaneState {
+    int32_t acc[LANES];
+    int32_t temp[TEMPS][LANES];
+    uint32_t trapped = 0;
+    bool accSet = false;
+    bool evaluated = false;
+    int tempsUsed = 0;
+    bool lastStore = false;
+    bool lastPure = false;          // last instruction only computed ACC and cannot trap
+};
+
+
+struct Search {
+    const Shape* shape = nullptr;
+    bool hasE = false;
+    std::vector<int> leaves;            // leaf slots the shape uses
+    int32_t vars[LANES][VARS];
+    int32_t want[LANES];
+    uint32_t wantTrapped = 0;
+    std::vector<Candidate> alphabet;
+    std::vector<Candidate> path;
+    std::vector<std::vector<Candidate>> found;
+    std::unordered_map<uint64_t, int> seen; // state hash -> most instructions left when visited
+};
+
+static int32_t operandValue(const Search& s, const LaneState& state, int operand, int lane) {
+    if (operand < VARS) return s.vars[lane][operand];
+    if (operand < IMM0) return state.temp[operand - TEMP0][lane];
+    return operand - IMM0;
+}
+
+static uint64_t hashState(const LaneState& state) {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&](uint64_t v) { h = (h ^ v) * 1099511628211ull; };
+    mix(state.trapped);
+    mix(static_cast<uint64_t>(state.accSet) | static_cast<uint64_t>(state.evaluated) << 1 |
+        static_cast<uint64_t>(state.lastStore) << 2 | static_cast<uint64_t>(state.lastPure) << 3 |
+        static_cast<uint64_t>(state.tempsUsed) << 4);
+    for (int lane = 0; lane < LANES; ++lane) {
+        mix(static_cast<uint32_t>(state.acc[lane]));
+        for (int t = 0; t < state.tempsUsed; ++t) mix(static_cast<uint32_t>(state.temp[t][lane]));
+    }
+    return h;
+}
+
+static bool reachesGoal(const Search& s, const LaneState& state) {
+    if (!state.accSet || state.evaluated != s.hasE || state.trapped != s.wantTrapped) return false;
+    for (int lane = 0; lane < LANES; ++lane) {
+        if (!(state.trapped >> lane & 1) && state.acc[lane] != s.want[lane]) return false;
+    }
+    return true;
+}
+
+// depth-first over sequences of exactly `left` more instructions; states reached before
+// with at least as many instructions left are not searched again
+static void search(Search& s, const LaneState& state, int left) {
+    if (left == 0) {
+        if (reachesGoal(s, state)) s.found.push_back(s.path);
+        return;
+    }
+    uint64_t key = hashState(state);
+    auto visited = s.seen.find(key);
+    if (visited != s.seen.end() && visited->second >= left) return;
+    s.seen[key] = left;
+
+    for (const auto& c : s.alphabet) {
+        Op op = c.op;
+        bool store = op == STORE;
+        bool eval = op == EVAL;
+        bool load = op == LOAD || eval;
+        if (!state.accSet && !load) continue;
+        // overwriting a value nothing read, storing twice, or ending on a store gains nothing
+        if (load && state.lastPure) continue;
+        if (store && (state.lastStore || left == 1)) continue;
+        if (eval && state.evaluated) continue;
+        if (!eval && s.hasE && !state.evaluated && left == 1) continue;
+        if (!store && c.operand >= TEMP0 && c.operand < IMM0 && c.operand - TEMP0 >= state.tempsUsed) continue;
+        if (store && c.operand - TEMP0 > state.tempsUsed) continue;
+        // ADD 0, SUB 0, MULT 1, DIV 1 change nothing; MULT 0 is LOAD 0
+        int imm = c.operand - IMM0;
+        if (c.operand >= IMM0 && ((imm == 0 && op != LOAD) || (imm == 1 && (op == MULT || op == DIV)))) {
+            continue;
+        }
+
+        LaneState next = state;
+        next.lastStore = store;
+        next.lastPure = !store && !eval && op != DIV;
+        if (store) {
+            int t = c.operand - TEMP0;
+            for (int lane = 0; lane < LANES; ++lane) next.temp[t][lane] = state.acc[lane];
+            next.tempsUsed = std::max(state.tempsUsed, t + 1);
+        } else {
+            for (int lane = 0; lane < LANES; ++lane) {
+                if (next.trapped >> lane & 1) continue;
+                if (eval) {
+                    next.acc[lane] = s.vars[lane][E];
+                } else if (!apply(op, next.acc[lane], operandValue(s, state, c.operand, lane))) {
+                    next.trapped |= 1u << lane;
+                    next.acc[lane] = 0;
+                }
+            }
+            next.accSet = true;
+            next.evaluated = state.evaluated || eval;
+        }
+        s.path.push_back(c);
+        search(s, next, left - 1);
+        s.path.pop_back();
+    }
+}
+
+// whether a sequence matches the shape on one assignment
+static bool agrees(const Shape& shape, const std::vector<Candidate>& code, const int32_t* vars) {
+    int32_t want;
+    bool wantOk = evaluate(shape, vars, want);
+    int32_t acc = 0, temp[TEMPS] = {0, 0};
+    for (const auto& c : code) {
+        if (c.op == EVAL) acc = vars[E];
+        else if (c.op == STORE) temp[c.operand - TEMP0] = acc;
+        else {
+            int32_t x = c.operand < VARS ? vars[c.operand] : c.operand < IMM0 ? temp[c.operand - TEMP0] : c.operand - IMM0;
+            if (!apply(c.op, acc, x)) return !wantOk;
+        }
+    }
+    return wantOk && acc == want;
+}
+
+// every assignment of values to the shape's operands, calling check until it fails
+static bool allAssignments(const std::vector<int>& slots, const std::vector<int32_t>& values,
+                           const std::function<bool(const int32_t*)>& check) {
+    int32_t vars[VARS] = {0, 0, 0, 0, 0};
+    std::vector<size_t> digit(slots.size());
+    while (true) {
+        for (size_t i = 0; i < slots.size(); ++i) vars[slots[i]] = values[digit[i]];
+        if (!check(vars)) return false;
+        size_t i = 0;
+        for (; i < slots.size() && ++digit[i] == values.size(); ++i) digit[i] = 0;
+        if (i == slots.size()) return true;
+    }
+}
+
+static const int RANDOM_CHECKS = 20000;
+
+static int32_t randomValue(std::mt19937& rng) {
+    static const int32_t edges[] = {0, 1, -1, 2, -2, 3, INT_MIN, INT_MAX, INT_MIN + 1, 65536};
+    switch (rng() % 4) {
+        case 0: return edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+        case 1: return static_cast<int32_t>(rng() % 21) - 10;
+        default: return static_cast<int32_t>(rng());
+    }
+}
+
+static bool verify(const Shape& shape, const std::vector<int>& slots, const std::vector<Candidate>& code,
+                   std::mt19937& rng) {
+    auto check = [&](const int32_t* vars) { return agrees(shape, code, vars); };
+    if (!allAssignments(slots, {-3, -2, -1, 0, 1, 2, 3}, check)) return false;
+    if (!allAssignments(slots, {INT_MIN, INT_MIN + 1, -2, -1, 0, 1, 2, INT_MAX}, check)) return false;
+    for (int i = 0; i < RANDOM_CHECKS; ++i) {
+        int32_t vars[VARS] = {0, 0, 0, 0, 0};
+        for (int slot : slots) vars[slot] = randomValue(rng);
+        if (!check(vars)) return false;
+    }
+    return true;
+}
+
+static void collectSlots(const Shape& shape, std::vector<int>& slots) {
+    if (shape.op.empty()) slots.push_back(shape.operand == 'e' ? E : shape.operand - 'a');
+    for (const auto& child : shape.children) collectSlots(child, slots);
+}
+
+static int codeCost(const std::vector<Candidate>& code) {
+    int cost = 0;
+    for (const auto& c : code) {
+        if (c.op != EVAL) cost += opcodeCost("vm", OP_NAMES[c.op]);
+    }
+    return cost;
+}
+
+static int tempsUsed(const std::vector<Candidate>& code) {
+    int temps = 0;
+    for (const auto& c : code) {
+        if (c.operand >= TEMP0 && c.operand < IMM0) temps = std::max(temps, c.operand - TEMP0 + 1);
+    }
+    return temps;
+}
+
+// shortest verified sequence for a shape (empty if none beats the template within maxLength)
+static std::vector<Candidate> superoptimize(const Shape& shape, int maxLength, std::mt19937& rng) {
+    Search s;
+    s.shape = &shape;
+    std::vector<int> slots;
+    collectSlots(shape, slots);
+    for (int slot : slots) {
+        if (slot == E) s.hasE = true;
+        else s.leaves.push_back(slot);
+    }
+
+    // edge values and zeros in the first lanes, so traps show up early
+    for (int lane = 0; lane < LANES; ++lane) {
+        for (int slot = 0; slot < VARS; ++slot) {
+            s.vars[lane][slot] = lane < 8 ? (lane * 7 + slot * 3) % 5 - 2 : randomValue(rng);
+        }
+        bool ok = evaluate(shape, s.vars[lane], s.want[lane]);
+        if (!ok) {
+            s.wantTrapped |= 1u << lane;
+            s.want[lane] = 0;
+        }
+    }
+
+    // cheaper operations first, so the first sequence of a length tends to be the cheapest
+    if (s.hasE) s.alphabet.push_back({EVAL, E});
+    for (Op op : {LOAD, STORE, ADD, SUB, MULT, DIV}) {
+        if (op == STORE) {
+            for (int t = 0; t < TEMPS; ++t) s.alphabet.push_back({op, TEMP0 + t});
+            continue;
+        }
+        for (int leaf : s.leaves) s.alphabet.push_back({op, leaf});
+        for (int t = 0; t < TEMPS; ++t) s.alphabet.push_back({op, TEMP0 + t});
+        for (int v = 0; v < IMMS; ++v) s.alphabet.push_back({op, IMM0 + v});
+    }
+
+    int limit = std::min(maxLength, templateLength(shape) - 1);
+    for (int length = s.hasE ? 0 : 1; length <= limit; ++length) {
+        s.seen.clear();
+        s.found.clear();
+        LaneState start;
+        std::fill(start.acc, start.acc + LANES, 0);
+        for (int t = 0; t < TEMPS; ++t) std::fill(start.temp[t], start.temp[t] + LANES, 0);
+        search(s, start, length + (s.hasE ? 1 : 0));
+
+        std::vector<Candidate> best;
+        for (const auto& code : s.found) {
+            if (!verify(shape, slots, code, rng)) continue;
+            if (best.empty() || codeCost(code) < codeCost(best) ||
+                (codeCost(code) == codeCost(best) && tempsUsed(code) < tempsUsed(best))) {
+                best = code;
+            }
+        }
+        if (!best.empty()) return best;
+    }
+    return {};
+}
+
+static std::string operandText(int operand) {
+    if (operand < E) return std::string(1, static_cast<char>('a' + operand));
+    if (operand == E) return "e";
+    if (operand < IMM0) return "t" + std::to_string(operand - TEMP0);
+    return std::to_string(operand - IMM0);
+}
+
+static int generate(int maxLength, int maxOps, unsigned seed, const std::string& outPath) {
+    std::mt19937 rng(seed);
+    std::vector<RewriteRule> rules;
+    int shapes = 0;
+    for (const auto& shape : allShapes(maxOps)) {
+        shapes++;
+        std::vector<Candidate> code = superoptimize(shape, maxLength, rng);
+        if (code.empty()) continue;
+        RewriteRule rule;
+        rule.shape = shape;
+        rule.templateLength = templateLength(shape);
+        for (const auto& c : code) rule.code.push_back({OP_NAMES[c.op], operandText(c.operand)});
+        rules.push_back(rule);
+    }
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            std::cerr << "Could not write " << outPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+    out << "# generated by tools/superopt --max-length=" << maxLength << " --max-ops=" << maxOps << "; regenerate with: make rewrites\n";
+    writeRewrites(rules, out);
+    std::cerr << shapes << " shapes, " << rules.size() << " rules" << std::endl;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// measurement
+// ---------------------------------------------------------------------------
+
+struct Run {
+    size_t instructions = 0;
+    uint64_t steps = 0;
+    std::string output;
+};
+
+static bool compileAndRun(const std::string& path, const CodegenOptions& options, const std::string& input, Run& run) {
+    MappedFileSource source;
+    std::string error;
+    if (!source.open(path, error)) {
+        std::cerr << "Could not open file: " << path << std::endl;
+        return false;
+    }
+    Node* root = parser(source);
+    STATSEM statsem = staticSemantics(root);
+    AsmProgram program = generateProgram(root, statsem, options);
+    freeTree(root);
+
+    VMImage image;
+    if (!decodeProgram(program, image, error)) {
+        std::cerr << path << ": " << error << std::endl;
+        return false;
+    }
+    std::istringstream in(input);
+    std::ostringstream out;
+    VMResult result = runProgram(image, in, out);
+    run.instructions = program.code.size();
+    run.steps = result.steps;
+    run.output = out.str() + (result.ok ? "" : "error: " + result.error.substr(result.error.find(": ") + 2));
+    return true;
+}
+
+static double percent(double before, double after) {
+    return before > 0 ? 100 * (before - after) / before : 0;
+}
+
+static int measure(const std::string& rewritesPath, const std::string& inputPath, const std::vector<std::string>& files) {
+    CodegenOptions with;
+    std::string error;
+    if (!readRewrites(rewritesPath, with.rewrites, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::string input;
+    if (!inputPath.empty()) {
+        std::ifstream in(inputPath);
+        if (!in) {
+            std::cerr << "Could not open input: " << inputPath << std::endl;
+            return 1;
+        }
+        std::ostringstream text;
+        text << in.rdbuf();
+        input = text.str();
+    }
+
+    std::cout << std::left << std::setw(22) << "program" << std::right << std::setw(10) << "static" << std::setw(10)
+              << "rewritten" << std::setw(8) << "saved" << std::setw(14) << "dynamic" << std::setw(14) << "rewritten"
+              << std::setw(8) << "saved" << "\n" << std::fixed << std::setprecision(1);
+    Run total[2];
+    int mismatches = 0;
+    for (const auto& path : files) {
+        Run runs[2];
+        if (!compileAndRun(path, CodegenOptions(), input, runs[0]) || !compileAndRun(path, with, input, runs[1])) return 1;
+        for (int i = 0; i < 2; ++i) {
+            total[i].instructions += runs[i].instructions;
+            total[i].steps += runs[i].steps;
+        }
+        std::cout << std::left << std::setw(22) << path.substr(path.find_last_of('/') + 1) << std::right
+                  << std::setw(10) << runs[0].instructions << std::setw(10) << runs[1].instructions << std::setw(7)
+                  << percent(runs[0].instructions, runs[1].instructions) << "%" << std::setw(14) << runs[0].steps
+                  << std::setw(14) << runs[1].steps << std::setw(7) << percent(runs[0].steps, runs[1].steps) << "%";
+        if (runs[0].output != runs[1].output) {
+            std::cout << "  OUTPUT DIFFERS";
+            mismatches++;
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::left << std::setw(22) << "total" << std::right << std::setw(10) << total[0].instructions
+              << std::setw(10) << total[1].instructions << std::setw(7)
+              << percent(total[0].instructions, total[1].instructions) << "%" << std::setw(14) << total[0].steps
+              << std::setw(14) << total[1].steps << std::setw(7) << percent(total[0].steps, total[1].steps) << "%\n";
+    return mismatches ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    int maxLength = 5, maxOps = 2;
+    unsigned seed = 1;
+    bool measuring = false;
+    std::string outPath, rewritesPath, inputPath;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 13, "--max-length=") == 0) maxLength = std::atoi(arg.c_str() + 13);
+        else if (arg.compare(0, 10, "--max-ops=") == 0) maxOps = std::atoi(arg.c_str() + 10);
+        else if (arg.compare(0, 7, "--seed=") == 0) seed = static_cast<unsigned>(std::atoi(arg.c_str() + 7));
+        else if (arg == "-o" && i + 1 < argc) outPath = argv[++i];
+        else if (arg == "--measure") measuring = true;
+        else if (arg.compare(0, 11, "--rewrites=") == 0) rewritesPath = arg.substr(11);
+        else if (arg.compare(0, 8, "--input=") == 0) inputPath = arg.substr(8);
+        else if (arg.compare(0, 1, "-") == 0) return usage(argv[0]);
+        else files.push_back(arg);
+    }
+    if (measuring) {
+        if (rewritesPath.empty() || files.empty()) return usage(argv[0]);
+        return measure(rewritesPath, inputPath, files);
+    }
+    if (!files.empty() || maxLength < 1 || maxOps < 1 || maxOps > 3) return usage(argv[0]);
+    return generate(maxLength, maxOps, seed, outPath);
+}
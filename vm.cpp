@@ -0,0 +1,284 @@
+#include <cctype>
+#include <climits>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#include "vm.h"
+
+// ---------------------------------------------------------------------------
+// decoding
+// ---------------------------------------------------------------------------
+
+// opcodes in both operand forms: {memory, immediate}
+static const std::unordered_map<std::string, std::pair<VMOp, VMOp>>& valueOps() {
+    static const std::unordered_map<std::string, std::pair<VMOp, VMOp>> table = {
+        {"READ",  {VMOp::READ, VMOp::READ}},
+        {"WRITE", {VMOp::WRITE_M, VMOp::WRITE_I}},
+        {"LOAD",  {VMOp::LOAD_M, VMOp::LOAD_I}},
+        {"STORE", {VMOp::STORE, VMOp::STORE}},
+        {"ADD",   {VMOp::ADD_M, VMOp::ADD_I}},
+        {"SUB",   {VMOp::SUB_M, VMOp::SUB_I}},
+        {"MULT",  {VMOp::MULT_M, VMOp::MULT_I}},
+        {"DIV",   {VMOp::DIV_M, VMOp::DIV_I}},
+    };
+    return table;
+}
+
+static const std::unordered_map<std::string, VMOp>& branchOps() {
+    static const std::unordered_map<std::string, VMOp> table = {
+        {"BR", VMOp::BR}, {"BRNEG", VMOp::BRNEG}, {"BRZNEG", VMOp::BRZNEG},
+        {"BRPOS", VMOp::BRPOS}, {"BRZPOS", VMOp::BRZPOS}, {"BRZERO", VMOp::BRZERO},
+    };
+    return table;
+}
+
+static bool parseImmediate(const std::string& arg, int32_t& value) {
+    if (arg.empty() || !(std::isdigit(static_cast<unsigned char>(arg[0])) || arg[0] == '-')) return false;
+    size_t used = 0;
+    long long parsed = 0;
+    try {
+        parsed = std::stoll(arg, &used);
+    } catch (...) {
+        return false;
+    }
+    if (used != arg.size() || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = static_cast<int32_t>(parsed);
+    return true;
+}
+
+bool decodeProgram(const AsmProgram& program, VMImage& image, std::string& error) {
+    image = VMImage();
+    std::unordered_map<std::string, int32_t> labels, cells;
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        const std::string& label = program.code[i].label;
+        if (!label.empty() && !labels.insert({label, static_cast<int32_t>(i)}).second) {
+            error = "duplicate label '" + label + "'";
+            return false;
+        }
+    }
+    for (const auto& cell : program.data) {
+        if (!cells.insert({cell.name, static_cast<int32_t>(image.memory.size())}).second) {
+            error = "duplicate storage '" + cell.name + "'";
+            return false;
+        }
+        image.memory.push_back(cell.value);
+        image.cellNames.push_back(cell.name);
+    }
+
+    image.code.reserve(program.code.size());
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        const Instr& instr = program.code[i];
+        std::string text = instr.label.empty() ? "" : instr.label + ": ";
+        text += instr.op;
+        if (!instr.arg.empty()) text += " " + instr.arg;
+        image.text.push_back(text);
+        image.labels.push_back(instr.label);
+        image.lines.push_back(instr.line);
+
+        VMInstr decoded = {VMOp::NOOP, 0};
+        auto value = valueOps().find(instr.op);
+        auto branch = branchOps().find(instr.op);
+        if (value != valueOps().end()) {
+            int32_t immediate = 0;
+            auto cell = cells.find(instr.arg);
+            if (cell != cells.end()) {
+                decoded = {value->second.first, cell->second};
+            } else if (parseImmediate(instr.arg, immediate) &&
+                       instr.op != "READ" && instr.op != "STORE") {
+                decoded = {value->second.second, immediate};
+            } else {
+                error = "line " + std::to_string(i + 1) + ": undefined storage '" + instr.arg + "'";
+                return false;
+            }
+        } else if (branch != branchOps().end()) {
+            auto target = labels.find(instr.arg);
+            if (target == labels.end()) {
+                error = "line " + std::to_string(i + 1) + ": undefined label '" + instr.arg + "'";
+                return false;
+            }
+            decoded = {branch->second, target->second};
+        } else if (instr.op == "NOOP" || instr.op == "STOP") {
+            decoded.op = instr.op == "NOOP" ? VMOp::NOOP : VMOp::STOP;
+        } else {
+            error = "line " + std::to_string(i + 1) + ": unknown instruction '" + instr.op + "'";
+            return false;
+        }
+        image.code.push_back(decoded);
+    }
+    if (image.code.empty() || image.code.back().op != VMOp::STOP) {
+        // never run off the end of the instruction array
+        image.code.push_back({VMOp::STOP, 0});
+        image.text.push_back("STOP");
+        image.labels.push_back("");
+        image.lines.push_back(0);
+    }
+    return true;
+}
+
+bool parseAsm(std::istream& in, AsmProgram& program, std::string& error) {
+    program = AsmProgram();
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream words(line);
+        std::string first, second, extra;
+        if (!(words >> first)) continue;
+        words >> second >> extra;
+        Instr instr = Instr();
+        if (first.size() > 1 && first.back() == ':') {
+            instr.label = first.substr(0, first.size() - 1);
+            first = second;
+            second = extra;
+            extra.clear();
+            words >> extra;
+        }
+        bool isOp = valueOps().count(first) || branchOps().count(first) || first == "NOOP" || first == "STOP";
+        if (isOp) {
+            instr.op = first;
+            instr.arg = second;
+            program.code.push_back(instr);
+        } else {
+            // storage line: name value
+            int32_t value = 0;
+            if (!instr.label.empty() || !parseImmediate(second, value)) {
+                error = "line " + std::to_string(lineNo) + ": cannot parse '" + line + "'";
+                return false;
+            }
+            program.data.push_back({first, value});
+            continue;
+        }
+        if (!extra.empty()) {
+            error = "line " + std::to_string(lineNo) + ": trailing text '" + extra + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// execution
+// ---------------------------------------------------------------------------
+
+// arithmetic wraps like the 32-bit target instead of overflowing
+static inline int32_t wrapAdd(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+static inline int32_t wrapSub(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+static inline int32_t wrapMul(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+
+// threaded dispatch through computed goto where the compiler supports it, a switch otherwise
+template <bool Counting>
+static void execute(const VMImage& image, std::istream& in, std::ostream& out, VMResult& result) {
+    const VMInstr* const code = image.code.data();
+    const VMInstr* ip = code;
+    int32_t* const mem = result.memory.data();
+    uint64_t* const counts = Counting ? result.counts.data() : nullptr;
+    int32_t acc = 0;
+    int32_t divisor = 0;
+    uint64_t steps = 0;
+
+#define VM_COUNT() do { steps++; if (Counting) counts[ip - code]++; } while (0)
+#if defined(__GNUC__)
+    // must list the handlers in VMOp order
+    static const void* const handlers[] = {
+        &&op_READ, &&op_WRITE_M, &&op_WRITE_I, &&op_LOAD_M, &&op_LOAD_I, &&op_STORE,
+        &&op_ADD_M, &&op_ADD_I, &&op_SUB_M, &&op_SUB_I, &&op_MULT_M, &&op_MULT_I, &&op_DIV_M, &&op_DIV_I,
+        &&op_BR, &&op_BRNEG, &&op_BRZNEG, &&op_BRPOS, &&op_BRZPOS, &&op_BRZERO, &&op_NOOP, &&op_STOP,
+    };
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH() do { VM_COUNT(); goto *handlers[static_cast<int>(ip->op)]; } while (0)
+    VM_DISPATCH();
+#else
+#define VM_CASE(name) case VMOp::name:
+#define VM_DISPATCH() goto dispatch
+dispatch:
+    VM_COUNT();
+    switch (ip->op) {
+#endif
+#define VM_NEXT() do { ++ip; VM_DISPATCH(); } while (0)
+#define VM_JUMP(cond) do { if (cond) ip = code + ip->operand; else ++ip; VM_DISPATCH(); } while (0)
+
+    VM_CASE(READ) {
+        long long value = 0;
+        if (!(in >> value)) {
+            result.ok = false;
+            result.error = "READ: expected an integer on input";
+            goto done;
+        }
+        mem[ip->operand] = static_cast<int32_t>(value);
+        VM_NEXT();
+    }
+    VM_CASE(WRITE_M) { out << mem[ip->operand] << '\n'; VM_NEXT(); }
+    VM_CASE(WRITE_I) { out << ip->operand << '\n'; VM_NEXT(); }
+    VM_CASE(LOAD_M) { acc = mem[ip->operand]; VM_NEXT(); }
+    VM_CASE(LOAD_I) { acc = ip->operand; VM_NEXT(); }
+    VM_CASE(STORE) { mem[ip->operand] = acc; VM_NEXT(); }
+    VM_CASE(ADD_M) { acc = wrapAdd(acc, mem[ip->operand]); VM_NEXT(); }
+    VM_CASE(ADD_I) { acc = wrapAdd(acc, ip->operand); VM_NEXT(); }
+    VM_CASE(SUB_M) { acc = wrapSub(acc, mem[ip->operand]); VM_NEXT(); }
+    VM_CASE(SUB_I) { acc = wrapSub(acc, ip->operand); VM_NEXT(); }
+    VM_CASE(MULT_M) { acc = wrapMul(acc, mem[ip->operand]); VM_NEXT(); }
+    VM_CASE(MULT_I) { acc = wrapMul(acc, ip->operand); VM_NEXT(); }
+    VM_CASE(DIV_M) { divisor = mem[ip->operand]; goto divide; }
+    VM_CASE(DIV_I) { divisor = ip->operand; goto divide; }
+    VM_CASE(BR) { ip = code + ip->operand; VM_DISPATCH(); }
+    VM_CASE(BRNEG) { VM_JUMP(acc < 0); }
+    VM_CASE(BRZNEG) { VM_JUMP(acc <= 0); }
+    VM_CASE(BRPOS) { VM_JUMP(acc > 0); }
+    VM_CASE(BRZPOS) { VM_JUMP(acc >= 0); }
+    VM_CASE(BRZERO) { VM_JUMP(acc == 0); }
+    VM_CASE(NOOP) { VM_NEXT(); }
+    VM_CASE(STOP) { goto done; }
+#if !defined(__GNUC__)
+    }
+#endif
+
+divide:
+    if (divisor == 0) {
+        result.ok = false;
+        result.error = "DIV: division by zero";
+        goto done;
+    }
+    acc = divisor == -1 ? wrapSub(0, acc) : acc / divisor;
+    VM_NEXT();
+
+done:
+    result.steps = steps;
+    if (!result.ok) result.error = "instruction " + std::to_string(ip - code + 1) + ": " + result.error;
+#undef VM_COUNT
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NEXT
+#undef VM_JUMP
+}
+
+VMResult runProgram(const VMImage& image, std::istream& in, std::ostream& out, bool countInstructions) {
+    VMResult result;
+    result.memory = image.memory;
+    if (countInstructions) {
+        result.counts.assign(image.code.size(), 0);
+        execute<true>(image, in, out, result);
+    } else {
+        execute<false>(image, in, out, result);
+    }
+    out.flush();
+    return result;
+}
+
+void printExecutionCounts(const VMImage& image, const VMResult& result, std::ostream& out) {
+    out << "executed " << result.steps << " instructions\n";
+    for (size_t i = 0; i < result.counts.size(); ++i) {
+        if (result.counts[i] == 0) continue;
+        out << std::setw(12) << result.counts[i] << "  " << std::setw(6) << i + 1 << "  " << image.text[i] << "\n";
+    }
+
+    // the same counts summed per source line, when the program carries line information
+    std::map<int, uint64_t> byLine;
+    for (size_t i = 0; i < result.counts.size() && i < image.lines.size(); ++i) {
+        if (image.lines[i] > 0 && result.counts[i] > 0) byLine[image.lines[i]] += result.counts[i];
+    }
+    if (byLine.empty()) return;
+    out << "by source line:\n";
+    for (const auto& entry : byLine) {
+        out << std::setw(12) << entry.second << "  line " << entry.first << "\n";
+    }
+}
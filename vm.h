@@ -0,0 +1,57 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "instr.h"
+
+// in-process interpreter for the accumulator code the compiler emits
+
+// decoded opcodes; operand kinds are split (_M memory cell, _I immediate) so the
+// interpreter never tests the operand form at run time
+enum class VMOp : uint8_t {
+    READ, WRITE_M, WRITE_I, LOAD_M, LOAD_I, STORE,
+    ADD_M, ADD_I, SUB_M, SUB_I, MULT_M, MULT_I, DIV_M, DIV_I,
+    BR, BRNEG, BRZNEG, BRPOS, BRZPOS, BRZERO, NOOP, STOP,
+};
+
+// one pre-decoded instruction: operand is a cell index, an immediate or an instruction index
+struct VMInstr {
+    VMOp op;
+    int32_t operand;
+};
+
+// program ready to execute: labels resolved to instruction indices, names to cell indices
+struct VMImage {
+    std::vector<VMInstr> code;
+    std::vector<int32_t> memory;        // initial cell values
+    std::vector<std::string> cellNames;
+    std::vector<std::string> text;      // source line of each instruction, for reports
+    std::vector<std::string> labels;    // label of each instruction (empty if none)
+    std::vector<int> lines;             // source line of each instruction (0 if unknown)
+};
+
+// outcome of one run
+struct VMResult {
+    bool ok = true;
+    std::string error;
+    uint64_t steps = 0;
+    std::vector<uint64_t> counts;       // executions per instruction (when requested)
+    std::vector<int32_t> memory;        // final cell values
+};
+
+// resolve labels and storage names; false with a message on malformed code
+bool decodeProgram(const AsmProgram& program, VMImage& image, std::string& error);
+
+// read .asm text (as written by writeAsm) back into instructions and storage
+bool parseAsm(std::istream& in, AsmProgram& program, std::string& error);
+
+// execute until STOP or a runtime error, reading READ values from in and writing WRITE values to out
+VMResult runProgram(const VMImage& image, std::istream& in, std::ostream& out, bool countInstructions = false);
+
+// print per-instruction execution counts
+void printExecutionCounts(const VMImage& image, const VMResult& result, std::ostream& out);
+
+#endif
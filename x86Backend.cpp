@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "x86Backend.h"
+
+// registers free for cells: everything except %eax (ACC), %ecx/%edx (division),
+// %edi (runtime argument/result) and %esp. the runtime preserves all of them.
+static const char* const cellRegisters[] = {
+    "%ebx", "%ebp", "%esi", "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d",
+};
+
+// weight of an instruction for register allocation
+static const long long LOOP_WEIGHT = 8;
+static const int MAX_LOOP_DEPTH = 6;
+
+static bool isLiteral(const std::string& arg) {
+    return !arg.empty() && (std::isdigit(static_cast<unsigned char>(arg[0])) || arg[0] == '-');
+}
+
+static bool isBranch(const std::string& op) {
+    return op.compare(0, 2, "BR") == 0;
+}
+
+// loop nesting depth of every instruction: each backward branch closes a loop
+// spanning from its target to itself
+static std::vector<int> loopDepths(const std::vector<Instr>& code) {
+    std::unordered_map<std::string, size_t> labelIndex;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].label.empty()) labelIndex[code[i].label] = i;
+    }
+    std::vector<int> delta(code.size() + 1, 0);
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!isBranch(code[i].op)) continue;
+        auto target = labelIndex.find(code[i].arg);
+        if (target == labelIndex.end() || target->second > i) continue;
+        delta[target->second]++;
+        delta[i + 1]--;
+    }
+    std::vector<int> depth(code.size(), 0);
+    int running = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        running += delta[i];
+        depth[i] = running;
+    }
+    return depth;
+}
+
+// pick the cells that get a register, hottest first
+static std::map<std::string, std::string> allocateRegisters(const AsmProgram& program) {
+    std::vector<int> depth = loopDepths(program.code);
+    std::unordered_map<std::string, long long> weight;
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        const Instr& instr = program.code[i];
+        if (instr.arg.empty() || isBranch(instr.op) || isLiteral(instr.arg)) continue;
+        long long w = 1;
+        for (int d = 0; d < std::min(depth[i], MAX_LOOP_DEPTH); ++d) w *= LOOP_WEIGHT;
+        weight[instr.arg] += w;
+    }
+    std::vector<std::pair<long long, std::string>> ranked;
+    for (const auto& cell : program.data) {
+        auto it = weight.find(cell.name);
+        if (it != weight.end()) ranked.push_back({-it->second, cell.name});
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    std::map<std::string, std::string> assigned;
+    const size_t available = sizeof(cellRegisters) / sizeof(cellRegisters[0]);
+    for (size_t i = 0; i < ranked.size() && i < available; ++i) {
+        assigned[ranked[i].second] = cellRegisters[i];
+    }
+    return assigned;
+}
+
+// the runtime: buffered decimal I/O over raw syscalls. every routine preserves all
+// registers other than its result (%edi for __fs_read).
+static const char* const runtime = R"(
+# ---- runtime ----------------------------------------------------------------
+# __fs_write: append %edi in decimal and a newline to the output buffer
+__fs_write:
+    pushq %rax
+    pushq %rcx
+    pushq %rdx
+    pushq %rsi
+    pushq %rdi
+    pushq %r8
+    cmpq $4064, __fs_outlen(%rip)
+    jb 1f
+    call __fs_flush
+1:  movslq %edi, %rax
+    movq %rax, %r8
+    leaq __fs_digits+24(%rip), %rsi
+    movb $10, (%rsi)
+    testq %rax, %rax
+    jns 2f
+    negq %rax
+2:  movl $10, %ecx
+3:  xorl %edx, %edx
+    divq %rcx
+    addb $48, %dl
+    decq %rsi
+    movb %dl, (%rsi)
+    testq %rax, %rax
+    jnz 3b
+    testq %r8, %r8
+    jns 4f
+    decq %rsi
+    movb $45, (%rsi)
+4:  leaq __fs_digits+25(%rip), %rcx
+    subq %rsi, %rcx
+    movq __fs_outlen(%rip), %rdx
+    leaq __fs_outbuf(%rip), %rdi
+    addq %rdx, %rdi
+    addq %rcx, %rdx
+    movq %rdx, __fs_outlen(%rip)
+5:  movb (%rsi), %al
+    movb %al, (%rdi)
+    incq %rsi
+    incq %rdi
+    decq %rcx
+    jnz 5b
+    popq %r8
+    popq %rdi
+    popq %rsi
+    popq %rdx
+    popq %rcx
+    popq %rax
+    ret
+
+# __fs_flush: write out the output buffer
+__fs_flush:
+    pushq %rax
+    pushq %rcx
+    pushq %rdx
+    pushq %rsi
+    pushq %rdi
+    pushq %r11
+    leaq __fs_outbuf(%rip), %rsi
+    movq __fs_outlen(%rip), %rdx
+1:  testq %rdx, %rdx
+    jz 2f
+    movl $1, %eax
+    movl $1, %edi
+    syscall
+    testq %rax, %rax
+    jle 2f
+    addq %rax, %rsi
+    subq %rax, %rdx
+    jmp 1b
+2:  movq $0, __fs_outlen(%rip)
+    popq %r11
+    popq %rdi
+    popq %rsi
+    popq %rdx
+    popq %rcx
+    popq %rax
+    ret
+
+# __fs_getc: next input byte in %eax, -1 at end of input (clobbers %eax only)
+__fs_getc:
+    pushq %rcx
+    pushq %rdx
+    pushq %rsi
+    pushq %rdi
+    pushq %r11
+    movq __fs_inpos(%rip), %rcx
+    cmpq __fs_inlen(%rip), %rcx
+    jb 1f
+    xorl %eax, %eax
+    xorl %edi, %edi
+    leaq __fs_inbuf(%rip), %rsi
+    movl $4096, %edx
+    syscall
+    movq $0, __fs_inpos(%rip)
+    xorl %ecx, %ecx
+    testq %rax, %rax
+    jg 2f
+    movq $0, __fs_inlen(%rip)
+    movl $-1, %eax
+    jmp 3f
+2:  movq %rax, __fs_inlen(%rip)
+1:  leaq __fs_inbuf(%rip), %rsi
+    movzbl (%rsi,%rcx), %eax
+    incq %rcx
+    movq %rcx, __fs_inpos(%rip)
+3:  popq %r11
+    popq %rdi
+    popq %rsi
+    popq %rdx
+    popq %rcx
+    ret
+
+# __fs_read: parse the next (optionally negative) decimal integer into %edi
+__fs_read:
+    pushq %rax
+    pushq %rcx
+    pushq %rdx
+1:  call __fs_getc
+    cmpl $-1, %eax
+    je __fs_read_error
+    cmpl $32, %eax
+    je 1b
+    cmpl $9, %eax
+    jb 2f
+    cmpl $13, %eax
+    jbe 1b
+2:  xorl %ecx, %ecx
+    cmpl $45, %eax
+    jne 3f
+    movl $1, %ecx
+    call __fs_getc
+3:  subl $48, %eax
+    cmpl $9, %eax
+    ja __fs_read_error
+    xorl %edx, %edx
+4:  imull $10, %edx, %edx
+    addl %eax, %edx
+    call __fs_getc
+    subl $48, %eax
+    cmpl $9, %eax
+    jbe 4b
+    testl %ecx, %ecx
+    jz 5f
+    negl %edx
+5:  movl %edx, %edi
+    popq %rdx
+    popq %rcx
+    popq %rax
+    ret
+
+__fs_read_error:
+    leaq __fs_read_msg(%rip), %rsi
+    movl $__fs_read_msg_len, %edx
+    jmp __fs_fail
+
+__fs_div_error:
+    leaq __fs_div_msg(%rip), %rsi
+    movl $__fs_div_msg_len, %edx
+    jmp __fs_fail
+
+# __fs_fail: flush output, print the message at %rsi/%edx to stderr and exit 1
+__fs_fail:
+    call __fs_flush
+    movl $1, %eax
+    movl $2, %edi
+    syscall
+    movl $60, %eax
+    movl $1, %edi
+    syscall
+
+# __fs_exit: flush output and exit 0
+__fs_exit:
+    call __fs_flush
+    movl $60, %eax
+    xorl %edi, %edi
+    syscall
+
+    .section .rodata
+__fs_read_msg:
+    .ascii "Runtime error: READ: expected an integer on input\n"
+    .set __fs_read_msg_len, . - __fs_read_msg
+__fs_div_msg:
+    .ascii "Runtime error: DIV: division by zero\n"
+    .set __fs_div_msg_len, . - __fs_div_msg
+
+    .bss
+    .align 8
+__fs_outlen: .skip 8
+__fs_inpos: .skip 8
+__fs_inlen: .skip 8
+__fs_digits: .skip 32
+__fs_outbuf: .skip 4096
+__fs_inbuf: .skip 4096
+
+    .section .note.GNU-stack,"",@progbits
+)";
+
+void writeX86Assembly(const AsmProgram& program, std::ostream& out) {
+    std::map<std::string, std::string> regs = allocateRegisters(program);
+
+    // operand text for a cell or immediate
+    auto operand = [&](const std::string& arg) -> std::string {
+        if (isLiteral(arg)) return "$" + arg;
+        auto reg = regs.find(arg);
+        if (reg != regs.end()) return reg->second;
+        return "fs_" + arg + "(%rip)";
+    };
+    auto label = [](const std::string& name) { return ".Lfs_" + name; };
+
+    out << "# generated by compile --target=x86_64\n";
+    out << "    .text\n";
+    out << "    .globl _start\n";
+    out << "_start:\n";
+    for (const auto& cell : program.data) {
+        auto reg = regs.find(cell.name);
+        if (reg != regs.end()) out << "    movl $" << cell.value << ", " << reg->second << "\n";
+    }
+    out << "    xorl %eax, %eax\n";
+
+    for (const auto& instr : program.code) {
+        if (!instr.label.empty()) out << label(instr.label) << ":\n";
+        const std::string& op = instr.op;
+        if (op == "LOAD") out << "    movl " << operand(instr.arg) << ", %eax\n";
+        else if (op == "STORE") out << "    movl %eax, " << operand(instr.arg) << "\n";
+        else if (op == "ADD") out << "    addl " << operand(instr.arg) << ", %eax\n";
+        else if (op == "SUB") out << "    subl " << operand(instr.arg) << ", %eax\n";
+        else if (op == "MULT") {
+            if (isLiteral(instr.arg)) out << "    imull $" << instr.arg << ", %eax, %eax\n";
+            else out << "    imull " << operand(instr.arg) << ", %eax\n";
+        }
+        else if (op == "DIV") {
+            // a -1 divisor negates (wrapping) instead of faulting on INT_MIN
+            out << "    movl " << operand(instr.arg) << ", %ecx\n";
+            out << "    testl %ecx, %ecx\n";
+            out << "    jz __fs_div_error\n";
+            out << "    cmpl $-1, %ecx\n";
+            out << "    jne 1f\n";
+            out << "    negl %eax\n";
+            out << "    jmp 2f\n";
+            out << "1:  cltd\n";
+            out << "    idivl %ecx\n";
+            out << "2:\n";
+        }
+        else if (op == "READ") {
+            out << "    call __fs_read\n";
+            out << "    movl %edi, " << operand(instr.arg) << "\n";
+        }
+        else if (op == "WRITE") {
+            out << "    movl " << operand(instr.arg) << ", %edi\n";
+            out << "    call __fs_write\n";
+        }
+        else if (op == "BR") out << "    jmp " << label(instr.arg) << "\n";
+        else if (isBranch(op)) {
+            const char* jcc = "je";
+            if (op == "BRNEG") jcc = "js";
+            else if (op == "BRZNEG") jcc = "jle";
+            else if (op == "BRPOS") jcc = "jg";
+            else if (op == "BRZPOS") jcc = "jns";
+            out << "    testl %eax, %eax\n";
+            out << "    " << jcc << " " << label(instr.arg) << "\n";
+        }
+        else if (op == "STOP") out << "    jmp __fs_exit\n";
+        // NOOP emits nothing
+    }
+    out << runtime;
+
+    out << "    .data\n";
+    out << "    .align 4\n";
+    for (const auto& cell : program.data) {
+        out << "fs_" << cell.name << ": .long " << cell.value << "\n";
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef X86_BACKEND_H
+#define X86_BACKEND_H
+
+#include <iostream>
+#include "instr.h"
+
+// ahead-of-time backend: translate generated accumulator code into a standalone GNU as
+// x86-64 Linux program (entry point _start, no libc). ACC is kept in %eax, the most
+// heavily used cells in spare registers, the rest in .data with their initial values.
+// build with:  as prog.s -o prog.o && ld prog.o -o prog   (or cc -nostdlib prog.s -o prog)
+void writeX86Assembly(const AsmProgram& program, std::ostream& out);
+
+#endif